@@ -14,103 +14,176 @@
 // along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "canon.h"
+#include <string.h>
 
-static Edge* STARTEDGE[MAXORDER];
-static int CODE[MAXSIZE];
+static void init_code(Generator* gen, DoublePreDeco* dpd, Edge edge) {
+  VertexMarks* marks = &gen->vertexmarks;
+  Edge* startedge = gen->startedge;
+  int actual_number = 1, last_number = 2, vertex, c;
+  Edge run, *order = gen->edgeorder;
+  CodeEntry* code = gen->code;
 
-static Edge* NUMBERING[MAXSIZE][MAXSIZE];
+  reset_vertex_marks(marks, dpd->order);
 
-static VertexMarks _VERTEXMARKS;
-static VertexMarks* VERTEXMARKS = &_VERTEXMARKS;
-
-static void init_code(DoublePreDeco* dpd, Edge* edge) {
-  int i, actual_number = 1, last_number = 2, vertex;
-  Edge *run, **numbering = NUMBERING[0];
-  int* code = CODE;
-
-  reset_vertex_marks(VERTEXMARKS, dpd->order);
-
-  mark_vertex(VERTEXMARKS, edge->start, 1);
-  mark_vertex(VERTEXMARKS, edge->end, 2);
-  STARTEDGE[1] = edge->inverse;
+  mark_vertex(marks, gen->start[edge], 1);
+  mark_vertex(marks, gen->end[edge], 2);
+  startedge[1] = inverse(edge);
 
   while (actual_number <= dpd->order) {
-    *numbering = edge;
-    numbering++;
-    for (run = edge->next; run != edge; run = run->next) {
-      vertex = run->end;
-      if (!(*code = vertex_mark(VERTEXMARKS, vertex))) {
-        STARTEDGE[last_number++] = run->inverse;
-        mark_vertex(VERTEXMARKS, vertex, last_number);
-        *code = -degree(vertex);
+    *order = edge;
+    order++;
+    for (run = gen->next[edge]; run != edge; run = gen->next[run]) {
+      vertex = gen->end[run];
+      if (!(c = vertex_mark(marks, vertex))) {
+        startedge[last_number++] = inverse(run);
+        mark_vertex(marks, vertex, last_number);
+        c = -degree(gen, vertex);
       }
+      *code = CODE_ZERO + c;
       code++;
-      *numbering = run;
-      numbering++;
+      *order = run;
+      order++;
     }
-    *code = 0;
+    *code = CODE_ZERO;
     code++;
-    edge = STARTEDGE[actual_number++];
+    edge = startedge[actual_number++];
   }
 }
 
-static int compare_code(DoublePreDeco* dpd, Edge* edge, int number) {
-  int i, actual_number = 1, last_number = 2, vertex, c;
-  Edge *run, **numbering = NUMBERING[number];
-  int* code = CODE;
+static int compare_block(CodeEntry* block, CodeEntry* code, int length) {
+  // Compare a block of the code at once. For byte codes, memcmp is vectorized
+  // by the C library, which picks the SSE2 or AVX2 version for the host at
+  // load time.
+
+#if MAXSIZE < 256
+  return memcmp(block, code, length);
+#else
+  for (int i = 0; i < length; i++)
+    if (block[i] != code[i])
+      return block[i] < code[i] ? -1 : 1;
+  return 0;
+#endif
+}
+
+static int compare_code(Generator* gen,
+                        DoublePreDeco* dpd,
+                        Edge edge,
+                        Edge* permutation) {
+  // Compare the code starting at the given edge with the code of init_code.
+  // If they are equal, the automorphism that maps the edges of init_code to
+  // the edges of this code is stored as a permutation.
 
-  reset_vertex_marks(VERTEXMARKS, dpd->order);
+  VertexMarks* marks = &gen->vertexmarks;
+  Edge* startedge = gen->startedge;
+  int actual_number = 1, last_number = 2, vertex, c;
+  Edge run, *order = gen->edgeorder;
+  CodeEntry candidate[MAXSIZE];
+  CodeEntry *code = candidate, *block = candidate;
 
-  mark_vertex(VERTEXMARKS, edge->start, 1);
-  mark_vertex(VERTEXMARKS, edge->end, 2);
-  STARTEDGE[1] = edge->inverse;
+  reset_vertex_marks(marks, dpd->order);
+
+  mark_vertex(marks, gen->start[edge], 1);
+  mark_vertex(marks, gen->end[edge], 2);
+  startedge[1] = inverse(edge);
 
   while (actual_number <= dpd->order) {
-    *numbering = edge;
-    numbering++;
-    for (run = edge->next; run != edge; run = run->next) {
-      vertex = run->end;
-      if (!(c = vertex_mark(VERTEXMARKS, vertex))) {
-        STARTEDGE[last_number++] = run->inverse;
-        mark_vertex(VERTEXMARKS, vertex, last_number);
-        c = -degree(vertex);
+    permutation[*order] = edge;
+    order++;
+    for (run = gen->next[edge]; run != edge; run = gen->next[run]) {
+      vertex = gen->end[run];
+      if (!(c = vertex_mark(marks, vertex))) {
+        startedge[last_number++] = inverse(run);
+        mark_vertex(marks, vertex, last_number);
+        c = -degree(gen, vertex);
+      }
+      *code = CODE_ZERO + c;
+      code++;
+      permutation[*order] = run;
+      order++;
+    }
+    *code = CODE_ZERO;
+    code++;
+    if ((c = compare_block(block, gen->code + (block - candidate),
+                           code - block)))
+      return c > 0 ? -1 : 1;
+    block = code;
+    edge = startedge[actual_number++];
+  }
+
+  return 0;
+}
+
+static int compare_prefix(Generator* gen, Edge edge) {
+  // Compare the first two blocks of the code starting at the given edge with
+  // the code of init_code, like compare_code. The visited vertices are kept in
+  // a vertex set, so nothing has to be reset, and candidates that differ in the
+  // rotations around their endpoints never reach compare_code.
+
+  VertexSet visited;
+  CodeEntry* code = gen->code;
+  int c;
+
+  clear_vertices(&visited);
+  add_vertex(&visited, gen->start[edge]);
+  add_vertex(&visited, gen->end[edge]);
+
+  for (int block = 0; block < 2; block++) {
+    for (Edge run = gen->next[edge]; run != edge; run = gen->next[run]) {
+      int vertex = gen->end[run];
+      if (has_vertex(&visited, vertex)) {
+        c = 1;
+      } else {
+        add_vertex(&visited, vertex);
+        c = -degree(gen, vertex);
       }
+      c += CODE_ZERO;
       if (c > *code)
         return -1;
       if (c < *code)
         return 1;
       code++;
-      *numbering = run;
-      numbering++;
     }
-    if (0 > *code)
-      return -1;
-    if (0 < *code)
-      return 1;
+    // Both endpoints have the same degree, so the blocks end together
     code++;
-    edge = STARTEDGE[actual_number++];
+    edge = inverse(edge);
   }
 
   return 0;
 }
 
-static int edge_cmp(DoublePreDeco* dpd, Edge* a, Edge* b) {
-  if (degree(a->start) < degree(b->start))
+static int find(Edge* parent, int x) {
+  while (parent[x] != x)
+    x = parent[x] = parent[parent[x]];
+  return x;
+}
+
+static void unite(Edge* parent, int x, int y) {
+  x = find(parent, x);
+  y = find(parent, y);
+  if (x < y)
+    parent[y] = x;
+  else
+    parent[x] = y;
+}
+
+static int edge_cmp(Generator* gen, DoublePreDeco* dpd, Edge a, Edge b) {
+  if (degree(gen, gen->start[a]) < degree(gen, gen->start[b]))
     return -1;
-  if (degree(a->start) > degree(b->start))
+  if (degree(gen, gen->start[a]) > degree(gen, gen->start[b]))
     return 1;
-  if (degree(a->end) < degree(b->end))
+  if (degree(gen, gen->end[a]) < degree(gen, gen->end[b]))
     return -1;
-  if (degree(a->end) > degree(b->end))
+  if (degree(gen, gen->end[a]) > degree(gen, gen->end[b]))
     return 1;
   return 0;
 }
 
-static int add_to_list(DoublePreDeco* dpd,
-                       Edge** list,
-                       Edge* edge,
-                       Edge* candidate) {
-  switch (edge_cmp(dpd, candidate, edge)) {
+static int add_to_list(Generator* gen,
+                       DoublePreDeco* dpd,
+                       Edge* list,
+                       Edge edge,
+                       Edge candidate) {
+  switch (edge_cmp(gen, dpd, candidate, edge)) {
     case -1:
       return -1;
     case 0:
@@ -121,172 +194,266 @@ static int add_to_list(DoublePreDeco* dpd,
   }
 }
 
-static Edge* EDGELIST[MAXSIZE];
-static int NB_SYM = 0;
+static int reject(Generator* gen, DoublePreDeco* dpd, int cause) {
+  // Count the cause of a rejection for --stats, and return 0.
 
-static EdgeMarks _EDGEMARKS;
-static EdgeMarks* EDGEMARKS = &_EDGEMARKS;
+  if (gen->stats)
+    gen->stats[dpd->order].rejects[cause]++;
+  return 0;
+}
 
-int canon(DoublePreDeco* dpd, int ext, Edge* edge, Edge** canonical_edges) {
+int canon(Generator* gen,
+          DoublePreDeco* dpd,
+          int ext,
+          Edge edge,
+          Edge* canonical_edges) {
   // Check whether the given extension applied at the given edge is the
   // canonical reduction for the given double predecoration.
   // If so, return the number of edge orbits and store a canonical edge for
   // each orbit in the given array.
 
-  Edge* run = edge;
-  int listlength = 0, added, i;
+  Edge run = edge, *list = gen->edgelist;
+  int listlength = 0, added, i, vertex;
+  VertexSet set;
+
+  if (gen->stats)
+    gen->stats[dpd->order].canon_calls++;
 
   if (dpd->n2 != 0 && ext > 2)
-    return 0;
+    return reject(gen, dpd, REJECT_N2);
   if (dpd->n1 != 0 && ext > 3)
-    return 0;
+    return reject(gen, dpd, REJECT_N1);
 
   /* Find extension 1 */
   if (ext == 0) {
     for (i = 0; i < dpd->order; i++) {
-      run = get_edge(i);
+      run = get_edge(gen, i);
       do {
         listlength += added =
-            add_to_list(dpd, EDGELIST + listlength, edge, run);
+            add_to_list(gen, dpd, list + listlength, edge, run);
         if (added == -1)
-          return 0;
-        run = run->next;
-      } while (run != get_edge(i));
+          return reject(gen, dpd, REJECT_LIST);
+        run = gen->next[run];
+      } while (run != get_edge(gen, i));
     }
   } else {
-    for (i = 0; i < dpd->n2; i++) {
-      run = get_edge(dpd->deg2[i]);
-      if (degree(run->end) > 3 || degree(run->inverse->prev->end) == 1) {
+    for (set = dpd->deg2; (vertex = pop_vertex(&set)) >= 0;) {
+      run = get_edge(gen, vertex);
+      if (degree(gen, gen->end[run]) > 3 ||
+          degree(gen, gen->end[gen->prev[inverse(run)]]) == 1) {
         if (ext != 1)
-          return 0;
-        listlength += added =
-            add_to_list(dpd, EDGELIST + listlength, edge, run->inverse->prev);
+          return reject(gen, dpd, REJECT_EXT);
+        listlength += added = add_to_list(gen, dpd, list + listlength, edge,
+                                          gen->prev[inverse(run)]);
         if (added == -1)
-          return 0;
+          return reject(gen, dpd, REJECT_LIST);
       }
-      run = run->next;
-      if (degree(run->end) > 3 || degree(run->inverse->prev->end) == 1) {
+      run = gen->next[run];
+      if (degree(gen, gen->end[run]) > 3 ||
+          degree(gen, gen->end[gen->prev[inverse(run)]]) == 1) {
         if (ext != 1)
-          return 0;
-        listlength += added =
-            add_to_list(dpd, EDGELIST + listlength, edge, run->inverse->prev);
+          return reject(gen, dpd, REJECT_EXT);
+        listlength += added = add_to_list(gen, dpd, list + listlength, edge,
+                                          gen->prev[inverse(run)]);
         if (added == -1)
-          return 0;
+          return reject(gen, dpd, REJECT_LIST);
       }
     }
   }
 
   /* Find extension 2 */
   if (ext > 1) {
-    for (i = 0; i < dpd->n2; i++) {
-      run = get_edge(dpd->deg2[i]);
-      listlength += added =
-          add_to_list(dpd, EDGELIST + listlength, edge, run->inverse->prev);
+    for (set = dpd->deg2; (vertex = pop_vertex(&set)) >= 0;) {
+      run = get_edge(gen, vertex);
+      listlength += added = add_to_list(gen, dpd, list + listlength, edge,
+                                        gen->prev[inverse(run)]);
       if (added == -1)
-        return 0;
-      run = run->next;
-      listlength += added =
-          add_to_list(dpd, EDGELIST + listlength, edge, run->inverse->prev);
+        return reject(gen, dpd, REJECT_LIST);
+      run = gen->next[run];
+      listlength += added = add_to_list(gen, dpd, list + listlength, edge,
+                                        gen->prev[inverse(run)]);
       if (added == -1)
-        return 0;
+        return reject(gen, dpd, REJECT_LIST);
     }
   }
 
   /* Find extension 3 */
   if (ext > 2) {
-    for (i = 0; i < dpd->n1; i++) {
-      run = get_edge(dpd->deg1[i]);
-      listlength += added =
-          add_to_list(dpd, EDGELIST + listlength, edge, run->inverse->prev);
+    for (set = dpd->deg1; (vertex = pop_vertex(&set)) >= 0;) {
+      run = get_edge(gen, vertex);
+      listlength += added = add_to_list(gen, dpd, list + listlength, edge,
+                                        gen->prev[inverse(run)]);
       if (added == -1)
-        return 0;
+        return reject(gen, dpd, REJECT_LIST);
     }
   }
 
   /* Find extension 4 */
   if (ext > 3) {
-    for (i = 0; i < dpd->order; i++)
-      if (degree(i) == 3) {
-        run = get_edge(i);
-        if (run->end != run->next->end && run->end != run->prev->end &&
-            run->next->end != run->prev->end) {
-          if (degree(run->end) > 3) {
-            listlength += added = add_to_list(dpd, EDGELIST + listlength, edge,
-                                              run->inverse->prev);
-            if (added == -1)
-              return 0;
-          }
-          run = run->next;
-          if (degree(run->end) > 3) {
-            listlength += added = add_to_list(dpd, EDGELIST + listlength, edge,
-                                              run->inverse->prev);
-            if (added == -1)
-              return 0;
-          }
-          run = run->next;
-          if (degree(run->end) > 3) {
-            listlength += added = add_to_list(dpd, EDGELIST + listlength, edge,
-                                              run->inverse->prev);
-            if (added == -1)
-              return 0;
-          }
+    for (set = dpd->deg3; (vertex = pop_vertex(&set)) >= 0;) {
+      run = get_edge(gen, vertex);
+      if (gen->end[run] != gen->end[gen->next[run]] &&
+          gen->end[run] != gen->end[gen->prev[run]] &&
+          gen->end[gen->next[run]] != gen->end[gen->prev[run]]) {
+        if (degree(gen, gen->end[run]) > 3) {
+          listlength += added = add_to_list(gen, dpd, list + listlength, edge,
+                                            gen->prev[inverse(run)]);
+          if (added == -1)
+            return reject(gen, dpd, REJECT_LIST);
+        }
+        run = gen->next[run];
+        if (degree(gen, gen->end[run]) > 3) {
+          listlength += added = add_to_list(gen, dpd, list + listlength, edge,
+                                            gen->prev[inverse(run)]);
+          if (added == -1)
+            return reject(gen, dpd, REJECT_LIST);
+        }
+        run = gen->next[run];
+        if (degree(gen, gen->end[run]) > 3) {
+          listlength += added = add_to_list(gen, dpd, list + listlength, edge,
+                                            gen->prev[inverse(run)]);
+          if (added == -1)
+            return reject(gen, dpd, REJECT_LIST);
         }
       }
+    }
   }
 
-  init_code(dpd, edge);
+  init_code(gen, dpd, edge);
+
+  // The automorphism group acts freely on the edges, so a candidate in the
+  // orbit of the edge under the automorphisms found so far is the image of
+  // exactly one of them, and its code does not have to be compared. Every
+  // automorphism that is found is a new generator.
+  Edge* orbits = gen->edge_orbits;
 
-  NB_SYM = 1;
+  gen->nb_sym = 1;
+  gen->nb_generators = 0;
   for (i = 0; i < listlength; i++)
-    if (EDGELIST[i] != edge) {
-      switch (compare_code(dpd, EDGELIST[i], NB_SYM)) {
+    if (list[i] != edge) {
+      if (gen->nb_generators &&
+          find(orbits, list[i]) == find(orbits, edge)) {
+        gen->nb_sym += 1;
+        continue;
+      }
+      switch (compare_prefix(gen, list[i])) {
         case 1:
-          return 0;
+          return reject(gen, dpd, REJECT_PREFIX);
+        case -1:
+          continue;
+      }
+      Edge* generator = gen->generators[gen->nb_generators];
+      if (gen->stats)
+        gen->stats[dpd->order].compare_code_calls++;
+      switch (compare_code(gen, dpd, list[i], generator)) {
+        case 1:
+          return reject(gen, dpd, REJECT_CODE);
         case 0:
-          NB_SYM += 1;
+          if (gen->nb_generators == 0)
+            for (int e = 0; e < dpd->size; e++)
+              orbits[e] = e;
+          gen->nb_sym += 1;
+          gen->nb_generators += 1;
+          for (int e = 0; e < dpd->size; e++)
+            unite(orbits, e, generator[e]);
       }
     }
 
+  if (gen->stats)
+    gen->stats[dpd->order].nb_sym[gen->nb_sym < STATS_MAX_SYM
+                                      ? gen->nb_sym
+                                      : STATS_MAX_SYM]++;
+
+  if (gen->nb_generators == 0) {
+    // Every edge is an orbit
+    memcpy(canonical_edges, gen->edgeorder, dpd->size * sizeof(Edge));
+    return dpd->size;
+  }
+
+  EdgeMarks* marks = &gen->edgemarks;
   int nb_edge_orbits = 0;
-  reset_edge_marks(EDGEMARKS, 1);
+  reset_edge_marks(marks, 1);
 
   for (i = 0; i < dpd->size; i++) {
-    run = NUMBERING[0][i];
-    if (!edge_mark(EDGEMARKS, run)) {
+    run = gen->edgeorder[i];
+    if (!edge_mark(marks, find(orbits, run))) {
       canonical_edges[nb_edge_orbits++] = run;
-      mark_edge(EDGEMARKS, run, 1);
-      for (int n = 1; n < NB_SYM; n++) {
-        mark_edge(EDGEMARKS, NUMBERING[n][i], 1);
-      }
+      mark_edge(marks, find(orbits, run), 1);
     }
   }
 
   return nb_edge_orbits;
 }
 
-int compute_vertex_orbits(DoublePreDeco* dpd, int* canonical_vertices) {
+int compute_vertex_orbits(Generator* gen,
+                          DoublePreDeco* dpd,
+                          int* canonical_vertices) {
   // Return the number of vertex orbits and store a canonical vertex for
   // each orbit in the given array.
 
+  VertexMarks* marks = &gen->vertexmarks;
+  Vertex* orbits = gen->vertex_orbits;
   int nb_vertex_orbits = 0;
-  reset_vertex_marks(VERTEXMARKS, 1);
+
+  for (int v = 0; v < dpd->order; v++)
+    orbits[v] = v;
+  for (int n = 0; n < gen->nb_generators; n++)
+    for (int e = 0; e < dpd->size; e++)
+      unite(orbits, gen->start[e], gen->start[gen->generators[n][e]]);
+
+  reset_vertex_marks(marks, 1);
 
   for (int i = 0; i < dpd->size; i++) {
-    int vertex = NUMBERING[0][i]->start;
-    if (!vertex_mark(VERTEXMARKS, vertex)) {
+    int vertex = gen->start[gen->edgeorder[i]];
+    if (!vertex_mark(marks, find(orbits, vertex))) {
       canonical_vertices[nb_vertex_orbits++] = vertex;
-      for (int n = 0; n < NB_SYM; n++) {
-        mark_vertex(VERTEXMARKS, NUMBERING[n][i]->start, 1);
-      }
+      mark_vertex(marks, find(orbits, vertex), 1);
     }
   }
 
   return nb_vertex_orbits;
 }
 
-static int SYMMETRIES[MAXSIZE];
+static void map_vertices(Generator* gen,
+                         DoublePreDeco* dpd,
+                         Edge edge,
+                         Edge edge2,
+                         Vertex* image) {
+  // Store the image of every vertex under the automorphism that maps edge to
+  // edge2.
+
+  VertexMarks* marks = &gen->vertexmarks;
+  Edge *startedge = gen->startedge, *startedge2 = gen->startedge2;
+  int actual_number = 1, last_number = 2, vertex;
+  Edge run, run2;
+
+  reset_vertex_marks(marks, 1);
 
-int fix_vertex(DoublePreDeco* dpd,
+  mark_vertex(marks, gen->start[edge], 1);
+  mark_vertex(marks, gen->end[edge], 1);
+  image[gen->start[edge]] = gen->start[edge2];
+  image[gen->end[edge]] = gen->end[edge2];
+  startedge[1] = inverse(edge);
+  startedge2[1] = inverse(edge2);
+
+  while (actual_number <= dpd->order) {
+    for (run = gen->next[edge], run2 = gen->next[edge2]; run != edge;
+         run = gen->next[run], run2 = gen->next[run2]) {
+      vertex = gen->end[run];
+      if (!vertex_mark(marks, vertex)) {
+        mark_vertex(marks, vertex, 1);
+        image[vertex] = gen->end[run2];
+        startedge[last_number] = inverse(run);
+        startedge2[last_number++] = inverse(run2);
+      }
+    }
+    edge = startedge[actual_number];
+    edge2 = startedge2[actual_number++];
+  }
+}
+
+int fix_vertex(Generator* gen,
+               DoublePreDeco* dpd,
                int vertex,
                int* canonical_vertices,
                int* fixpoint) {
@@ -297,36 +464,41 @@ int fix_vertex(DoublePreDeco* dpd,
   // If there is another vertex that is a fixpoint for this symmetry group,
   // store this vertex too.
 
-  int rotations = 0, i, k = 0, nb_vertex_orbits = 0;
+  VertexMarks* marks = &gen->vertexmarks;
+  Vertex* rotation = gen->rotation;
+  Edge* orbits = gen->edge_orbits;
+  Edge edge = get_edge(gen, vertex), run;
+  int i, v, nb_vertex_orbits = 0;
 
   *fixpoint = -1;
 
-  while (NUMBERING[0][k]->start != vertex)
-    k++;
-  for (i = 1; i < NB_SYM; i++)
-    if (NUMBERING[i][k]->start == vertex) {
-      SYMMETRIES[rotations++] = i;
-    }
+  if (gen->nb_sym == 1)
+    return nb_vertex_orbits;
 
-  if (rotations == 0)
+  // The rotations form a cyclic group, generated by the rotation that maps
+  // edge to the next edge around the vertex in the same edge orbit.
+  for (run = gen->next[edge]; run != edge; run = gen->next[run])
+    if (find(orbits, run) == find(orbits, edge))
+      break;
+
+  if (run == edge)
     return nb_vertex_orbits;
 
-  reset_vertex_marks(VERTEXMARKS, 1);
-  mark_vertex(VERTEXMARKS, vertex, 1);
+  map_vertices(gen, dpd, edge, run, rotation);
+
+  reset_vertex_marks(marks, 1);
+  mark_vertex(marks, vertex, 1);
 
   for (i = 0; i < dpd->size; i++) {
-    int canon = NUMBERING[0][i]->start;
-    if (!vertex_mark(VERTEXMARKS, canon)) {
-      canonical_vertices[nb_vertex_orbits++] = canon;
-      mark_vertex(VERTEXMARKS, canon, 1);
-      for (k = 0; k < rotations; k++) {
-        int v = NUMBERING[SYMMETRIES[k]][i]->start;
-        if (!vertex_mark(VERTEXMARKS, v)) {
-          mark_vertex(VERTEXMARKS, v, 1);
-        } else {
-          *fixpoint = canon;
-          nb_vertex_orbits--;
-        }
+    int canon = gen->start[gen->edgeorder[i]];
+    if (!vertex_mark(marks, canon)) {
+      mark_vertex(marks, canon, 1);
+      if (rotation[canon] == canon) {
+        *fixpoint = canon;
+      } else {
+        canonical_vertices[nb_vertex_orbits++] = canon;
+        for (v = rotation[canon]; v != canon; v = rotation[v])
+          mark_vertex(marks, v, 1);
       }
     }
   }
@@ -334,14 +506,10 @@ int fix_vertex(DoublePreDeco* dpd,
   return nb_vertex_orbits;
 }
 
-static Edge* STARTEDGE2[MAXORDER];
-
-static VertexMarks _VERTEXMARKS2;
-static VertexMarks* VERTEXMARKS2 = &_VERTEXMARKS2;
-
-int fix_edges(DoublePreDeco* dpd,
-              Edge* edge,
-              Edge* edge2,
+int fix_edges(Generator* gen,
+              DoublePreDeco* dpd,
+              Edge edge,
+              Edge edge2,
               int* canonical_vertices,
               int* fixpoint) {
   // Fix the 2-cycle consisting of the given edges.
@@ -350,66 +518,68 @@ int fix_edges(DoublePreDeco* dpd,
   // If there is another vertex that is a fixpoint for this symmetry group,
   // store this vertex too.
 
+  VertexMarks *marks = &gen->vertexmarks, *marks2 = &gen->vertexmarks2;
+  Edge *startedge = gen->startedge, *startedge2 = gen->startedge2;
   int i, actual_number = 1, last_number = 2, vertex, vertex2,
          nb_vertex_orbits = 0;
-  Edge *run, *run2;
+  Edge run, run2;
 
   *fixpoint = -1;
 
-  if (degree(edge->start) < degree(edge2->start))
+  if (degree(gen, gen->start[edge]) < degree(gen, gen->start[edge2]))
     return 0;
-  if (degree(edge->start) > degree(edge2->start))
+  if (degree(gen, gen->start[edge]) > degree(gen, gen->start[edge2]))
     return -1;
 
-  reset_vertex_marks(VERTEXMARKS, dpd->order);
-  reset_vertex_marks(VERTEXMARKS2, dpd->order);
+  reset_vertex_marks(marks, dpd->order);
+  reset_vertex_marks(marks2, dpd->order);
 
-  mark_vertex(VERTEXMARKS, edge->start, 1);
-  mark_vertex(VERTEXMARKS, edge->end, 2);
-  mark_vertex(VERTEXMARKS2, edge2->start, 1);
-  mark_vertex(VERTEXMARKS2, edge2->end, 2);
-  STARTEDGE[0] = edge;
-  STARTEDGE2[0] = edge2;
-  STARTEDGE[1] = edge->inverse;
-  STARTEDGE2[1] = edge2->inverse;
+  mark_vertex(marks, gen->start[edge], 1);
+  mark_vertex(marks, gen->end[edge], 2);
+  mark_vertex(marks2, gen->start[edge2], 1);
+  mark_vertex(marks2, gen->end[edge2], 2);
+  startedge[0] = edge;
+  startedge2[0] = edge2;
+  startedge[1] = inverse(edge);
+  startedge2[1] = inverse(edge2);
 
   while (actual_number <= last_number) {
-    for (run = edge->next, run2 = edge2->next; run != edge;
-         run = run->next, run2 = run2->next) {
-      vertex = run->end;
-      vertex2 = run2->end;
+    for (run = gen->next[edge], run2 = gen->next[edge2]; run != edge;
+         run = gen->next[run], run2 = gen->next[run2]) {
+      vertex = gen->end[run];
+      vertex2 = gen->end[run2];
 
-      if (vertex_mark(VERTEXMARKS, vertex) < vertex_mark(VERTEXMARKS2, vertex2))
+      if (vertex_mark(marks, vertex) < vertex_mark(marks2, vertex2))
         return 0;
-      if (vertex_mark(VERTEXMARKS, vertex) > vertex_mark(VERTEXMARKS2, vertex2))
+      if (vertex_mark(marks, vertex) > vertex_mark(marks2, vertex2))
         return -1;
 
-      if (!vertex_mark(VERTEXMARKS, vertex)) {
-        STARTEDGE[last_number] = run->inverse;
-        STARTEDGE2[last_number++] = run2->inverse;
-        mark_vertex(VERTEXMARKS, vertex, last_number);
-        mark_vertex(VERTEXMARKS2, vertex2, last_number);
+      if (!vertex_mark(marks, vertex)) {
+        startedge[last_number] = inverse(run);
+        startedge2[last_number++] = inverse(run2);
+        mark_vertex(marks, vertex, last_number);
+        mark_vertex(marks2, vertex2, last_number);
 
-        if (degree(vertex) < degree(vertex2))
+        if (degree(gen, vertex) < degree(gen, vertex2))
           return 0;
-        if (degree(vertex) > degree(vertex2))
+        if (degree(gen, vertex) > degree(gen, vertex2))
           return -1;
       }
     }
-    edge = STARTEDGE[actual_number];
-    edge2 = STARTEDGE2[actual_number++];
+    edge = startedge[actual_number];
+    edge2 = startedge2[actual_number++];
   }
 
-  reset_vertex_marks(VERTEXMARKS, 1);
+  reset_vertex_marks(marks, 1);
 
   for (i = 0; i < last_number; i++) {
-    int canon = STARTEDGE[i]->start;
-    if (!vertex_mark(VERTEXMARKS, canon)) {
+    int canon = gen->start[startedge[i]];
+    if (!vertex_mark(marks, canon)) {
       canonical_vertices[nb_vertex_orbits++] = canon;
-      mark_vertex(VERTEXMARKS, canon, 1);
-      int v = STARTEDGE2[i]->start;
-      if (!vertex_mark(VERTEXMARKS, v)) {
-        mark_vertex(VERTEXMARKS, v, 1);
+      mark_vertex(marks, canon, 1);
+      int v = gen->start[startedge2[i]];
+      if (!vertex_mark(marks, v)) {
+        mark_vertex(marks, v, 1);
       } else {
         *fixpoint = canon;
         nb_vertex_orbits--;
@@ -420,68 +590,108 @@ int fix_edges(DoublePreDeco* dpd,
   return nb_vertex_orbits;
 }
 
-int compare_edges(DoublePreDeco* dpd, Edge* edge, Edge* edge2, int v1, int v2) {
+static int reflection_fixpoints(Generator* gen,
+                                DoublePreDeco* dpd,
+                                Edge edge,
+                                Edge edge2,
+                                VertexSet* fixpoints) {
+  // Store the vertices that are fixed by the orientation-reversing
+  // automorphism that maps edge to edge2, and return 0 if there is no such
+  // automorphism. Vertices that can not be reached from edge are fixed.
+
+  int* image = gen->image;
+  Edge *startedge = gen->startedge, *startedge2 = gen->startedge2;
   int i, actual_number = 1, last_number = 2, vertex, vertex2;
-  Edge *run, *run2;
+  Edge run, run2;
 
-  if (degree(edge->end) != degree(edge2->end))
-    return 0;
-  if ((edge->end == v1 || edge->end == v2 || edge2->end == v1 ||
-       edge2->end == v2) &&
-      edge->end != edge2->end)
+  if (degree(gen, gen->start[edge]) != degree(gen, gen->start[edge2]) ||
+      degree(gen, gen->end[edge]) != degree(gen, gen->end[edge2]))
     return 0;
 
-  reset_vertex_marks(VERTEXMARKS, dpd->order);
-  reset_vertex_marks(VERTEXMARKS2, dpd->order);
+  for (i = 0; i < dpd->order; i++)
+    image[i] = -1;
 
-  mark_vertex(VERTEXMARKS, edge->start, 1);
-  mark_vertex(VERTEXMARKS, edge->end, 2);
-  mark_vertex(VERTEXMARKS2, edge2->start, 1);
-  mark_vertex(VERTEXMARKS2, edge2->end, 2);
-  STARTEDGE[0] = edge;
-  STARTEDGE2[0] = edge2;
-  STARTEDGE[1] = edge->inverse;
-  STARTEDGE2[1] = edge2->inverse;
+  image[gen->start[edge]] = gen->start[edge2];
+  image[gen->end[edge]] = gen->end[edge2];
+  startedge[0] = edge;
+  startedge2[0] = edge2;
+  startedge[1] = inverse(edge);
+  startedge2[1] = inverse(edge2);
 
   while (actual_number <= last_number) {
-    for (run = edge->next, run2 = edge2->prev; run != edge;
-         run = run->next, run2 = run2->prev) {
-      vertex = run->end;
-      vertex2 = run2->end;
-
-      if (vertex_mark(VERTEXMARKS, vertex) !=
-          vertex_mark(VERTEXMARKS2, vertex2))
-        return 0;
+    for (run = gen->next[edge], run2 = gen->prev[edge2]; run != edge;
+         run = gen->next[run], run2 = gen->prev[run2]) {
+      vertex = gen->end[run];
+      vertex2 = gen->end[run2];
 
-      if (!vertex_mark(VERTEXMARKS, vertex)) {
-        STARTEDGE[last_number] = run->inverse;
-        STARTEDGE2[last_number++] = run2->inverse;
-        mark_vertex(VERTEXMARKS, vertex, last_number);
-        mark_vertex(VERTEXMARKS2, vertex2, last_number);
-
-        if (degree(vertex) != degree(vertex2))
-          return 0;
-        if ((vertex == v1 || vertex == v2 || vertex2 == v1 || vertex2 == v2) &&
-            vertex != vertex2)
+      if (image[vertex] < 0) {
+        if (degree(gen, vertex) != degree(gen, vertex2))
           return 0;
+        image[vertex] = vertex2;
+        startedge[last_number] = inverse(run);
+        startedge2[last_number++] = inverse(run2);
+      } else if (image[vertex] != vertex2) {
+        return 0;
       }
     }
-    edge = STARTEDGE[actual_number];
-    edge2 = STARTEDGE2[actual_number++];
+    edge = startedge[actual_number];
+    edge2 = startedge2[actual_number++];
   }
 
+  clear_vertices(fixpoints);
+  for (i = 0; i < dpd->order; i++)
+    if (image[i] < 0 || image[i] == i)
+      add_vertex(fixpoints, i);
+
   return 1;
 }
 
-int is_lsp(DoublePreDeco* dpd, int v0, int v1, int v2) {
-  Edge *edge, *run;
+void reset_reflections(Generator* gen, Edge edge) {
+  // The double predecoration has changed. Its reflections are computed from
+  // the component of the given edge when they are needed.
+
+  gen->nb_reflections = -1;
+  gen->reflection_edge = edge;
+}
+
+static void compute_reflections(Generator* gen, DoublePreDeco* dpd) {
+  // Store the fixpoints of every orientation-reversing automorphism. This is
+  // done once for each double predecoration, instead of once for each
+  // decoration in is_lsp.
+
+  Edge edge = gen->reflection_edge;
+  VertexSet fixpoints;
+  int i;
+
+  gen->nb_reflections = 0;
+  for (Edge edge2 = 0; edge2 < dpd->size; edge2++) {
+    // Skip the edges that are detached
+    if (gen->next[gen->prev[edge2]] != edge2 ||
+        gen->next[gen->prev[inverse(edge2)]] != inverse(edge2))
+      continue;
+    if (!reflection_fixpoints(gen, dpd, edge, edge2, &fixpoints) ||
+        first_vertex(fixpoints) < 0)
+      continue;
+    for (i = 0; i < gen->nb_reflections; i++)
+      if (!memcmp(&gen->reflections[i], &fixpoints, sizeof(VertexSet)))
+        break;
+    if (i == gen->nb_reflections)
+      gen->reflections[gen->nb_reflections++] = fixpoints;
+  }
+}
+
+int is_lsp(Generator* gen, DoublePreDeco* dpd, int v0, int v1, int v2) {
+  // Return whether the decoration is mirror symmetric.
 
-  run = edge = get_edge(v0);
-  do {
-    if (compare_edges(dpd, edge, run, v1, v2))
+  if (gen->nb_reflections < 0)
+    compute_reflections(gen, dpd);
+
+  for (int i = 0; i < gen->nb_reflections; i++) {
+    VertexSet* fixpoints = &gen->reflections[i];
+    if (has_vertex(fixpoints, v0) && has_vertex(fixpoints, v1) &&
+        has_vertex(fixpoints, v2))
       return 1;
-    run = run->next;
-  } while (run != edge);
+  }
 
   return 0;
 }
@@ -18,10 +18,11 @@
 
 #include "util.h"
 
-int canon(DoublePreDeco*, int, Edge*, Edge**);
-int compute_vertex_orbits(DoublePreDeco*, int*);
-int fix_vertex(DoublePreDeco*, int, int*, int*);
-int fix_edges(DoublePreDeco*, Edge*, Edge*, int*, int*);
-int is_lsp(DoublePreDeco*, int, int, int);
+int canon(Generator*, DoublePreDeco*, int, Edge, Edge*);
+int compute_vertex_orbits(Generator*, DoublePreDeco*, int*);
+int fix_vertex(Generator*, DoublePreDeco*, int, int*, int*);
+int fix_edges(Generator*, DoublePreDeco*, Edge, Edge, int*, int*);
+void reset_reflections(Generator*, Edge);
+int is_lsp(Generator*, DoublePreDeco*, int, int, int);
 
 #endif
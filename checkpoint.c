@@ -0,0 +1,122 @@
+// Copyright (C) 2022 Pieter Goetschalckx
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "checkpoint.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAGIC "doubledecogen checkpoint 1"
+
+int write_checkpoint(const char* filename, Checkpoint* checkpoint) {
+  // Write the checkpoint to a temporary file first, and rename it afterwards,
+  // so the previous checkpoint survives a crash while writing.
+  // Return 0 on success.
+
+  char tmpname[strlen(filename) + 5];
+  FILE* file;
+  int d, f;
+
+  snprintf(tmpname, sizeof(tmpname), "%s.tmp", filename);
+  if (!(file = fopen(tmpname, "w")))
+    return -1;
+
+  fprintf(file, "%s\n", MAGIC);
+  fprintf(file, "factor %d\n", checkpoint->factor);
+  fprintf(file, "mod %d\n", checkpoint->mod);
+  fprintf(file, "res %d\n", checkpoint->res);
+  fprintf(file, "split %d\n", checkpoint->split_level);
+  fprintf(file, "lsp %d\n", checkpoint->lsp);
+  fprintf(file, "connectivity %d\n", checkpoint->connectivity);
+  fprintf(file, "all %d\n", checkpoint->all);
+  fprintf(file, "base %d\n", checkpoint->base);
+  fprintf(file, "path %d %d", checkpoint->root, checkpoint->depth);
+  for (d = checkpoint->root; d <= checkpoint->depth; d++)
+    fprintf(file, " %d,%d", checkpoint->ext[d], checkpoint->orbit[d]);
+  fprintf(file, "\n");
+  fprintf(file, "splitnodes %llu\n", checkpoint->nb_split_nodes);
+  fprintf(file, "count");
+  for (f = 1; f <= checkpoint->factor; f++)
+    fprintf(file, " %llu", checkpoint->count[f]);
+  fprintf(file, "\nprecount");
+  for (f = 1; f <= checkpoint->factor; f++)
+    fprintf(file, " %llu", checkpoint->precount[f]);
+  fprintf(file, "\noffset");
+  for (f = 1; f <= checkpoint->factor; f++)
+    fprintf(file, " %ld", checkpoint->offset[f]);
+  fprintf(file, "\n");
+
+  if (fflush(file) || fsync(fileno(file)) || ferror(file)) {
+    fclose(file);
+    return -1;
+  }
+  fclose(file);
+
+  return rename(tmpname, filename);
+}
+
+static int read_word(FILE* file, const char* word) {
+  // Return whether the next word in the file is the given word.
+
+  char buffer[16];
+
+  return fscanf(file, " %15s", buffer) == 1 && !strcmp(buffer, word);
+}
+
+int read_checkpoint(const char* filename, Checkpoint* checkpoint) {
+  // Return 0 on success.
+
+  char magic[sizeof(MAGIC)];
+  FILE* file;
+  int d, f, ok;
+
+  if (!(file = fopen(filename, "r")))
+    return -1;
+
+  ok = fgets(magic, sizeof(magic), file) && !strcmp(magic, MAGIC) &&
+       fscanf(file, " factor %d", &checkpoint->factor) == 1 &&
+       checkpoint->factor >= 1 && checkpoint->factor <= MAXFACTOR &&
+       fscanf(file, " mod %d", &checkpoint->mod) == 1 &&
+       fscanf(file, " res %d", &checkpoint->res) == 1 &&
+       fscanf(file, " split %d", &checkpoint->split_level) == 1 &&
+       fscanf(file, " lsp %d", &checkpoint->lsp) == 1 &&
+       fscanf(file, " connectivity %d", &checkpoint->connectivity) == 1 &&
+       fscanf(file, " all %d", &checkpoint->all) == 1 &&
+       fscanf(file, " base %d", &checkpoint->base) == 1 &&
+       fscanf(file, " path %d %d", &checkpoint->root, &checkpoint->depth) ==
+           2 &&
+       checkpoint->root >= 0 && checkpoint->root <= checkpoint->depth &&
+       checkpoint->depth < MAXORDER;
+  for (d = checkpoint->root; ok && d <= checkpoint->depth; d++)
+    ok = fscanf(file, " %d,%d", &checkpoint->ext[d],
+                &checkpoint->orbit[d]) == 2 &&
+         checkpoint->ext[d] >= 1 && checkpoint->ext[d] <= 4 &&
+         checkpoint->orbit[d] >= 0;
+  ok = ok &&
+       fscanf(file, " splitnodes %llu", &checkpoint->nb_split_nodes) == 1 &&
+       read_word(file, "count");
+  for (f = 1; ok && f <= checkpoint->factor; f++)
+    ok = fscanf(file, " %llu", &checkpoint->count[f]) == 1;
+  ok = ok && read_word(file, "precount");
+  for (f = 1; ok && f <= checkpoint->factor; f++)
+    ok = fscanf(file, " %llu", &checkpoint->precount[f]) == 1;
+  ok = ok && read_word(file, "offset");
+  for (f = 1; ok && f <= checkpoint->factor; f++)
+    ok = fscanf(file, " %ld", &checkpoint->offset[f]) == 1;
+
+  fclose(file);
+
+  return ok ? 0 : -1;
+}
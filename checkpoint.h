@@ -0,0 +1,52 @@
+// Copyright (C) 2022 Pieter Goetschalckx
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+#include "util.h"
+
+typedef struct {
+  // The options that determine the construction tree and the counts.
+  int factor;
+  int mod;
+  int res;
+  int split_level;
+  int lsp;
+  int connectivity;
+  int all;
+
+  // The construction continues with extension ext[depth] at the canonical
+  // edge with index orbit[depth], after following the extensions at the
+  // smaller depths from the given base.
+  int base;
+  int root;
+  int depth;
+  int ext[MAXORDER];
+  int orbit[MAXORDER];
+
+  unsigned long long nb_split_nodes;
+  unsigned long long count[MAXFACTOR + 1];
+  unsigned long long precount[MAXFACTOR + 1];
+
+  // Size of the output file of each factor, or -1 if the output is not
+  // seekable.
+  long offset[MAXFACTOR + 1];
+} Checkpoint;
+
+int write_checkpoint(const char* filename, Checkpoint* checkpoint);
+int read_checkpoint(const char* filename, Checkpoint* checkpoint);
+
+#endif
@@ -15,98 +15,177 @@
 
 #include "complete.h"
 #include "canon.h"
+#include "deco_code.h"
+
+void check_and_count(Generator* gen,
+                     DoublePreDeco* dpd,
+                     int v0,
+                     int v1,
+                     int v2,
+                     int n) {
+  if (!get_filter_lsp() || is_lsp(gen, dpd, v0, v1, v2)) {
+    count(gen, n);
+    if (gen->buffer) {
+      write_decoration(gen, v0, v1, v2);
+      // Two decorations are counted if the reverse is not isomorphic
+      if (n == 2)
+        write_decoration(gen, v2, v1, v0);
+    }
+  }
+}
+
+static void count02(Generator* gen,
+                    DoublePreDeco* dpd,
+                    int nb_vertex_orbits,
+                    int fixpoint,
+                    int v1) {
+  // Count the completions of complete02 without selecting v0 and v2, if the
+  // decorations are not written or filtered. The canonical vertices are
+  // different from v1 and the fixpoint.
+
+  int* canonical_vertices = gen->canonical_vertices_fixed;
+  int i, v0, d, m, n = 0;
 
-static int CANONICAL_VERTICES[MAXORDER];
+  switch (nb_low_degree(dpd) - low_degree(gen, v1)) {
+    case 0:
+      if (nb_vertex_orbits == 0) {
+        n = (dpd->order - 1) * (dpd->order - 2);
+      } else {
+        n = nb_vertex_orbits * (dpd->order - 2 + (fixpoint >= 0));
+      }
+      break;
+    case 1:
+      if (dpd->n1 - (degree(gen, v1) == 1)) {
+        v0 = first_vertex(without_vertex(dpd->deg1, v1));
+      } else {
+        v0 = first_vertex(without_vertex(dpd->deg2, v1));
+      }
+      if (v0 == fixpoint) {
+        n = 2 * nb_vertex_orbits;
+      } else {
+        n = 2 * (dpd->order - 2);
+      }
+      break;
+    case 2:
+      // In cases 0 and 2, the other vertices of low degree have degree d
+      d = dpd->n1 - (degree(gen, v1) == 1) ? 1 : 2;
+      switch (dpd->n1 - (degree(gen, v1) == 1)) {
+        case 0:
+        case 2:
+          // The number of vertices of degree d other than v1
+          m = (d == 1 ? dpd->n1 : dpd->n2) - (degree(gen, v1) == d);
+          if (nb_vertex_orbits == 0) {
+            n = m * (m - 1);
+          } else {
+            for (i = 0; i < nb_vertex_orbits; i++)
+              if (degree(gen, canonical_vertices[i]) == d)
+                n += m - 1;
+          }
+          break;
+        case 1:
+          n = 2;
+          break;
+      }
+      break;
+  }
 
-void check_and_count(DoublePreDeco* dpd, int v0, int v1, int v2, int n) {
-  if (!get_filter_lsp() || is_lsp(dpd, v0, v1, v2))
-    count(n);
+  count(gen, n);
 }
 
-void complete02(DoublePreDeco* dpd,
+void complete02(Generator* gen,
+                DoublePreDeco* dpd,
                 int nb_vertex_orbits,
                 int fixpoint,
                 int v1) {
   // Given a double predecoration, a vertex v1 and the vertex orbits different
   // from v1, finish the completion by selecting v0 and v2 in all possible
-  // non isomorphic ways.
+  // non isomorphic ways. Vertices of low degree other than v1 have to be v0 or
+  // v2.
 
+  int* canonical_vertices = gen->canonical_vertices_fixed;
   int i = 0, v0, v2, d = 1;
+  VertexSet low, set, others;
+
+  if (!gen->buffer && !get_filter_lsp()) {
+    count02(gen, dpd, nb_vertex_orbits, fixpoint, v1);
+    return;
+  }
 
-  switch (dpd->n1 + dpd->n2 - (degree(v1) < 3)) {
+  switch (nb_low_degree(dpd) - low_degree(gen, v1)) {
     case 0:
       if (nb_vertex_orbits == 0) {
         for (v0 = 0; v0 < dpd->order - 1; v0++)
           if (v0 != v1) {
             for (v2 = v0 + 1; v2 < dpd->order; v2++)
               if (v2 != v1) {
-                check_and_count(dpd, v0, v1, v2, 2);
+                check_and_count(gen, dpd, v0, v1, v2, 2);
               }
           }
       } else {
         for (i = 0; i < nb_vertex_orbits; i++) {
-          v0 = CANONICAL_VERTICES[i];
+          v0 = canonical_vertices[i];
           for (v2 = 0; v2 < dpd->order; v2++)
-            if (v2 != v1 && v2 != v0) {
-              check_and_count(dpd, v0, v1, v2, 1);
+            if (v2 != v1 && v2 != v0 && v2 != fixpoint) {
+              check_and_count(gen, dpd, v0, v1, v2, 1);
             }
           if (fixpoint >= 0)
-            check_and_count(dpd, v0, v1, fixpoint, 2);
+            check_and_count(gen, dpd, v0, v1, fixpoint, 2);
         }
       }
       break;
     case 1:
-      if (dpd->n1 - (degree(v1) == 1)) {
-        v0 = dpd->deg1[0] != v1 ? dpd->deg1[0] : dpd->deg1[1];
+      if (dpd->n1 - (degree(gen, v1) == 1)) {
+        v0 = first_vertex(without_vertex(dpd->deg1, v1));
       } else {
-        v0 = dpd->deg2[0] != v1 ? dpd->deg2[0] : dpd->deg2[1];
+        v0 = first_vertex(without_vertex(dpd->deg2, v1));
       }
       if (v0 == fixpoint) {
         for (i = 0; i < nb_vertex_orbits; i++) {
-          check_and_count(dpd, fixpoint, v1, CANONICAL_VERTICES[i], 2);
+          check_and_count(gen, dpd, fixpoint, v1, canonical_vertices[i], 2);
         }
       } else {
         for (v2 = 0; v2 < dpd->order; v2++)
           if (v2 != v1 && v2 != v0) {
-            check_and_count(dpd, v0, v1, v2, 2);
+            check_and_count(gen, dpd, v0, v1, v2, 2);
           }
       }
       break;
     case 2:
-      switch (dpd->n1 - (degree(v1) == 1)) {
+      switch (dpd->n1 - (degree(gen, v1) == 1)) {
         case 0:
           d = 2;
         case 2:
+          // The vertices of degree d other than v1
+          low = without_vertex(d == 1 ? dpd->deg1 : dpd->deg2, v1);
           if (nb_vertex_orbits == 0) {
-            for (v0 = 0; v0 < dpd->order - 1; v0++)
-              if (v0 != v1 && degree(v0) == d) {
-                for (v2 = v0 + 1; v2 < dpd->order; v2++)
-                  if (v2 != v1 && degree(v2) == d) {
-                    check_and_count(dpd, v0, v1, v2, 2);
-                  }
+            for (set = low; (v0 = pop_vertex(&set)) >= 0;) {
+              for (others = set; (v2 = pop_vertex(&others)) >= 0;) {
+                check_and_count(gen, dpd, v0, v1, v2, 2);
               }
+            }
           } else {
             for (i = 0; i < nb_vertex_orbits; i++) {
-              if (degree(v0 = CANONICAL_VERTICES[i]) == d) {
-                for (v2 = 0; v2 < dpd->order; v2++)
-                  if (v2 != v1 && v2 != v0 && degree(v2) == d) {
-                    check_and_count(dpd, v0, v1, v2, 1);
-                  }
+              if (degree(gen, v0 = canonical_vertices[i]) == d) {
+                for (set = without_vertex(low, v0);
+                     (v2 = pop_vertex(&set)) >= 0;) {
+                  check_and_count(gen, dpd, v0, v1, v2, 1);
+                }
               }
             }
           }
           break;
         case 1:
-          v0 = dpd->deg1[0] != v1 ? dpd->deg1[0] : dpd->deg1[1];
-          v2 = dpd->deg2[0] != v1 ? dpd->deg2[0] : dpd->deg2[1];
-          check_and_count(dpd, v0, v1, v2, 2);
+          v0 = first_vertex(without_vertex(dpd->deg1, v1));
+          v2 = first_vertex(without_vertex(dpd->deg2, v1));
+          check_and_count(gen, dpd, v0, v1, v2, 2);
           break;
       }
       break;
   }
 }
 
-void complete_odd(DoublePreDeco* dpd,
+void complete_odd(Generator* gen,
+                  DoublePreDeco* dpd,
                   int nb_vertex_orbits,
                   int* canonical_vertices) {
   // Complete the double predecoration to all possible double decorations with
@@ -116,28 +195,34 @@ void complete_odd(DoublePreDeco* dpd,
   int i, v1, nb_vertex_orbits_fixed, fixpoint;
 
   for (i = 0; i < nb_vertex_orbits; i++) {
-    if (degree(v1 = canonical_vertices[i]) == 1) {
-      Edge* edge = get_edge(v1);
+    if (degree(gen, v1 = canonical_vertices[i]) == 1) {
+      Edge edge = get_edge(gen, v1);
 
-      if (degree(edge->end) == 3 && dpd->n1 + dpd->n2 == 3)
+      // The neighbour of v1 loses an edge
+      if (nb_low_degree(dpd) - low_degree(gen, v1) +
+              (degree(gen, gen->end[edge]) == get_connectivity()) >
+          2)
         continue;
 
-      Edge* edgeA = edge->inverse->prev;
+      Edge edgeA = gen->prev[inverse(edge)];
 
-      detach(dpd, edge->inverse);
+      detach(gen, dpd, inverse(edge));
+      reset_reflections(gen, edgeA);
 
-      nb_vertex_orbits_fixed = fix_edges(dpd, edgeA, edgeA->inverse->prev,
-                                         CANONICAL_VERTICES, &fixpoint);
+      nb_vertex_orbits_fixed =
+          fix_edges(gen, dpd, edgeA, gen->prev[inverse(edgeA)],
+                    gen->canonical_vertices_fixed, &fixpoint);
       if (nb_vertex_orbits_fixed >= 0) {
-        complete02(dpd, nb_vertex_orbits_fixed, fixpoint, v1);
+        complete02(gen, dpd, nb_vertex_orbits_fixed, fixpoint, v1);
       }
 
-      attach(dpd, edgeA, edge->inverse);
+      attach(gen, dpd, edgeA, inverse(edge));
     }
   }
 }
 
-void complete_even(DoublePreDeco* dpd,
+void complete_even(Generator* gen,
+                   DoublePreDeco* dpd,
                    int nb_vertex_orbits,
                    int* canonical_vertices) {
   // Complete the double predecoration to all possible double decorations with
@@ -145,13 +230,17 @@ void complete_even(DoublePreDeco* dpd,
 
   int i, v1, nb_vertex_orbits_fixed, fixpoint;
 
+  reset_reflections(gen, get_edge(gen, 0));
+
   for (i = 0; i < nb_vertex_orbits; i++) {
     v1 = canonical_vertices[i];
 
-    if (dpd->n1 + dpd->n2 < 3 ? degree(v1) > 1 : degree(v1) == 2) {
+    // The degree of v1 is doubled in the decorated polyhedron
+    if (2 * degree(gen, v1) >= get_connectivity() &&
+        nb_low_degree(dpd) - low_degree(gen, v1) <= 2) {
       nb_vertex_orbits_fixed =
-          fix_vertex(dpd, v1, CANONICAL_VERTICES, &fixpoint);
-      complete02(dpd, nb_vertex_orbits_fixed, fixpoint, v1);
+          fix_vertex(gen, dpd, v1, gen->canonical_vertices_fixed, &fixpoint);
+      complete02(gen, dpd, nb_vertex_orbits_fixed, fixpoint, v1);
     }
   }
 }
@@ -18,7 +18,7 @@
 
 #include "util.h"
 
-void complete_odd(DoublePreDeco*, int, int*);
-void complete_even(DoublePreDeco*, int, int*);
+void complete_odd(Generator*, DoublePreDeco*, int, int*);
+void complete_even(Generator*, DoublePreDeco*, int, int*);
 
 #endif
@@ -0,0 +1,141 @@
+// Copyright (C) 2022 Pieter Goetschalckx
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "deco_code.h"
+#include <stdlib.h>
+#include <string.h>
+#include "planar_code.h"
+
+// A decocode record consists of the planar code of a double predecoration,
+// followed by the numbers of v0, v1 and v2 in that code for each of its
+// decorations, and a terminating 0. If the planar code is the 16-bit variant,
+// these numbers are little-endian 16-bit numbers too.
+
+void write_deco_header(FILE* file, int wide) {
+  fputs(wide ? ">>deco_code le<<" : ">>deco_code<<", file);
+}
+
+static int wide(Generator* gen) {
+  // The 16-bit variant of the planar code starts with a 0 byte.
+
+  return MAXORDER > 255 && gen->planar_code[0] == 0;
+}
+
+void create_deco_buffers(Generator* gen,
+                         FILE** files,
+                         int min_factor,
+                         int max_factor) {
+  // Create a buffer for each factor. Factors with the same output file share
+  // their buffer.
+
+  for (int f = min_factor; f <= max_factor; f++) {
+    if (f > min_factor && files[f] == files[f - 1]) {
+      gen->buffers[f] = gen->buffers[f - 1];
+    } else {
+      gen->buffers[f] = malloc(sizeof(OutputBuffer));
+      gen->buffers[f]->file = files[f];
+      gen->buffers[f]->length = 0;
+      gen->buffers[f]->record = 0;
+      gen->buffers[f]->capacity = OUTPUT_BUFFER_SIZE;
+      gen->buffers[f]->data = malloc(OUTPUT_BUFFER_SIZE);
+    }
+  }
+}
+
+static void flush(OutputBuffer* buffer) {
+  // Write the complete records, and move the record that is being written to
+  // the start of the buffer.
+
+  fwrite(buffer->data, sizeof(unsigned char), buffer->record, buffer->file);
+  memmove(buffer->data, buffer->data + buffer->record,
+          buffer->length - buffer->record);
+  buffer->length -= buffer->record;
+  buffer->record = 0;
+}
+
+void flush_deco_buffers(Generator* gen) {
+  for (int f = 1; f <= MAXFACTOR; f++)
+    if (gen->buffers[f] && gen->buffers[f] != gen->buffers[f - 1])
+      flush(gen->buffers[f]);
+}
+
+void free_deco_buffers(Generator* gen) {
+  flush_deco_buffers(gen);
+  for (int f = MAXFACTOR; f > 0; f--) {
+    if (gen->buffers[f] && gen->buffers[f] != gen->buffers[f - 1]) {
+      free(gen->buffers[f]->data);
+      free(gen->buffers[f]);
+    }
+    gen->buffers[f] = NULL;
+  }
+}
+
+static unsigned char* reserve(OutputBuffer* buffer, size_t length) {
+  // Return a pointer to length free bytes at the end of the buffer.
+
+  if (buffer->length + length > buffer->capacity) {
+    flush(buffer);
+    // The record that is being written does not fit in the buffer
+    if (buffer->length + length > buffer->capacity) {
+      buffer->capacity = 2 * (buffer->length + length);
+      buffer->data = realloc(buffer->data, buffer->capacity);
+    }
+  }
+  buffer->length += length;
+  return buffer->data + buffer->length - length;
+}
+
+void start_deco_code(Generator* gen, int factor) {
+  // Start the record of the double predecoration in gen->planar_code for the
+  // given factor.
+
+  gen->buffer = gen->buffers[factor];
+  gen->pending = 1;
+}
+
+void write_decoration(Generator* gen, int v0, int v1, int v2) {
+  unsigned char* code;
+
+  if (gen->pending) {
+    code = reserve(gen->buffer, gen->planar_code_length);
+    memcpy(code, gen->planar_code, gen->planar_code_length);
+    gen->pending = 0;
+  }
+  if (wide(gen)) {
+    code = reserve(gen->buffer, 6);
+    code[0] = gen->number[v0] & 0xff;
+    code[1] = gen->number[v0] >> 8;
+    code[2] = gen->number[v1] & 0xff;
+    code[3] = gen->number[v1] >> 8;
+    code[4] = gen->number[v2] & 0xff;
+    code[5] = gen->number[v2] >> 8;
+  } else {
+    code = reserve(gen->buffer, 3);
+    code[0] = gen->number[v0];
+    code[1] = gen->number[v1];
+    code[2] = gen->number[v2];
+  }
+}
+
+void end_deco_code(Generator* gen) {
+  // Terminate the record, unless the predecoration has no decorations.
+
+  if (!gen->pending) {
+    int length = wide(gen) ? 2 : 1;
+    memset(reserve(gen->buffer, length), 0, length);
+    gen->buffer->record = gen->buffer->length;
+  }
+  gen->buffer = NULL;
+}
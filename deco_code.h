@@ -0,0 +1,32 @@
+// Copyright (C) 2022 Pieter Goetschalckx
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef DECO_CODE_H_
+#define DECO_CODE_H_
+
+#include <stdio.h>
+#include "util.h"
+
+void write_deco_header(FILE*, int);
+
+void create_deco_buffers(Generator*, FILE**, int, int);
+void flush_deco_buffers(Generator*);
+void free_deco_buffers(Generator*);
+
+void start_deco_code(Generator*, int);
+void write_decoration(Generator*, int, int, int);
+void end_deco_code(Generator*);
+
+#endif
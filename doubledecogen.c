@@ -13,180 +13,2082 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
+#include <errno.h>
 #include <getopt.h>
+#include <math.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
 #include "canon.h"
+#include "checkpoint.h"
 #include "complete.h"
+#include "deco_code.h"
 #include "extensions.h"
+#include "ledger.h"
+#include "network.h"
 #include "planar_code.h"
+#include "stats.h"
 #include "util.h"
 
 int OUTPUT = 0;
 int DPD_OUTPUT = 0;
 int ALL = 0;
-int CONNECTIVITY = 3;
 int RES = 0;
 int MOD = 1;
 int SPLIT_LEVEL = 3;
-FILE* OUTFILE;
+FILE* OUTFILES[MAXFACTOR + 1];
+char* OUTFILENAME = NULL;
 
 int FACTOR;
+int MIN_FACTOR;
 
-static Edge* CANONICAL_EDGES[MAXORDER][MAXSIZE];
-static int CANONICAL_VERTICES[MAXORDER];
-
-void grow(DoublePreDeco*, int);
-
-void try_extension(DoublePreDeco* dpd,
-                   int nb_edge_orbits,
-                   int (*extension)(DoublePreDeco*, Edge*),
-                   void (*reduction)(DoublePreDeco*, Edge*),
-                   int ext) {
-  int nb_edge_orbits_copy;
-
-  for (int i = 0; i < nb_edge_orbits; i++) {
-    Edge* edge = CANONICAL_EDGES[dpd->order][i];
-    DoublePreDeco copy = *dpd;
-    if (extension(&copy, edge)) {
-      CHECK(&copy);
-      if (copy.n1 + copy.n2 <= 4 &&
-          (nb_edge_orbits_copy =
-               canon(&copy, ext, edge, CANONICAL_EDGES[copy.order]))) {
-        grow(&copy, nb_edge_orbits_copy);
+int THREADS = 1;
+static Generator** GENERATORS;
+static atomic_int ACTIVE;
+
+char* CHECKPOINT_FILE = NULL;
+int CHECKPOINT_INTERVAL = 3600;
+static volatile sig_atomic_t CHECKPOINT_REQUEST = 0;
+static Checkpoint RESUME;
+static int RESUMING = 0;
+
+int ESTIMATE = 0;
+int CHOOSE_SPLIT = 0;
+#define SPLIT_SAMPLES 10000
+#define SPLIT_FRONTIER 1000
+// The seed of the random paths, or -1 if it is not given
+long SEED = -1;
+
+int WORKERS = 0;
+static char* SHARD_DIR;
+#define MAX_ATTEMPTS 3
+
+char* COORDINATOR = NULL;
+char* CONNECT = NULL;
+char* LEDGER_FILE = NULL;
+
+typedef struct {
+  // A unit of the split level, which is reached from the root of the base
+  // with extension ext[d] at the canonical edge with index orbit[d] at each
+  // depth d in between.
+  const char* id;
+  int base;
+  int depth;
+  int ext[MAXORDER];
+  int orbit[MAXORDER];
+  int found;
+} Root;
+
+int MANIFEST = 0;
+static Root* ROOTS;
+static int NB_ROOTS = 0;
+#define ROOT_NODE 1
+#define ROOT_ANCESTOR 2
+
+char* STATS_FILE = NULL;
+
+int PROGRESS_INTERVAL = 0;
+static atomic_int PROGRESS_REQUEST;
+static double START_TIME;
+static atomic_int STARTED_BASES;
+// The share of each base in the construction tree, estimated at the first
+// report from at most PROGRESS_SAMPLES random paths per base
+#define PROGRESS_SAMPLES 1000
+static double BASE_WEIGHTS[4];
+static pthread_once_t WEIGHED = PTHREAD_ONCE_INIT;
+// The generator in which the reports replay the paths of the generators
+static Generator* PROGRESS_REPLAY = NULL;
+
+__attribute__((noinline, cold))
+static void checkpoint(Generator* gen, int depth) {
+  // Save the state of the construction just before the claimed child of the
+  // node at the given depth is explored. Stop if the program is terminated.
+  // This is kept out of the search loop, which only tests for a request.
+
+  Checkpoint checkpoint;
+
+  checkpoint.factor = FACTOR;
+  checkpoint.mod = MOD;
+  checkpoint.res = RES;
+  checkpoint.split_level = SPLIT_LEVEL;
+  checkpoint.lsp = get_filter_lsp();
+  checkpoint.connectivity = get_connectivity();
+  checkpoint.all = ALL;
+  checkpoint.base = gen->base;
+  checkpoint.root = gen->root;
+  checkpoint.depth = depth;
+  for (int d = gen->root; d <= depth; d++) {
+    Frame* frame = &gen->frames[d];
+    checkpoint.ext[d] = frame->child / frame->nb_edge_orbits + 1;
+    checkpoint.orbit[d] = frame->child % frame->nb_edge_orbits;
+  }
+  checkpoint.nb_split_nodes = gen->nb_split_nodes;
+  for (int f = 1; f <= FACTOR; f++) {
+    checkpoint.count[f] = get_count(gen, f);
+    checkpoint.precount[f] = get_precount(gen, f);
+    checkpoint.offset[f] = -1;
+  }
+  if (OUTPUT)
+    flush_deco_buffers(gen);
+  for (int f = MIN_FACTOR; f <= FACTOR; f++) {
+    fflush(OUTFILES[f]);
+    checkpoint.offset[f] = ftell(OUTFILES[f]);
+  }
+
+  if (write_checkpoint(CHECKPOINT_FILE, &checkpoint))
+    fprintf(stderr, "Could not write checkpoint to %s\n", CHECKPOINT_FILE);
+
+  if (CHECKPOINT_REQUEST == SIGTERM) {
+    fprintf(stderr, "Terminated, checkpoint written to %s\n",
+            CHECKPOINT_FILE);
+    exit(1);
+  }
+
+  CHECKPOINT_REQUEST = 0;
+  alarm(CHECKPOINT_INTERVAL);
+}
+
+static void request_checkpoint(int signal) {
+  CHECKPOINT_REQUEST = signal;
+}
+
+static double now() {
+  struct timespec time;
+
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec + 1e-9 * time.tv_nsec;
+}
+
+static int nb_bases(int factor) {
+  // The second base has four vertices of degree 2, so with connectivity 3 it
+  // can only be completed after an extension.
+  int second = get_connectivity() < 3 ? 3 : 5;
+
+  return factor < second ? 1 : factor < 11 ? 2 : 3;
+}
+
+static int prune(DoublePreDeco* dpd) {
+  // Return whether none of the descendants of the node can be completed,
+  // because they have more than 3 vertices of low degree. An extension lowers
+  // the number of vertices of low degree by at most one, so the descendants
+  // at the last level have at least the number of the node minus the
+  // remaining levels.
+
+  int remaining = (FACTOR + 1) / 2 - (dpd->order - 2);
+
+  switch (get_connectivity()) {
+    case 3:
+      return dpd->n1 + dpd->n2 > 4 || dpd->n1 + dpd->n2 - remaining > 3;
+    case 2:
+      return dpd->n1 - remaining > 3;
+    default:
+      return 0;
+  }
+}
+
+static int base_depth(int base) {
+  // The bases have 3, 4 and 8 vertices.
+
+  return base == 1 ? 1 : base == 2 ? 2 : 6;
+}
+
+static void write_node_id(Generator* gen, int depth) {
+  // Write the ID of the node at the given depth to stdout: its base, followed
+  // by the extension and the orbit of the canonical edge at each depth above.
+
+  printf("%d", gen->base);
+  for (int d = base_depth(gen->base); d < depth; d++) {
+    Frame* frame = &gen->frames[d];
+    printf("/%d.%d", frame->child / frame->nb_edge_orbits + 1,
+           frame->child % frame->nb_edge_orbits);
+  }
+  printf("\n");
+}
+
+static int match_roots(Generator* gen, int depth) {
+  // Return whether the node at the given depth is one of the roots
+  // (ROOT_NODE), or an ancestor of one (ROOT_ANCESTOR).
+
+  int match = 0;
+
+  for (int i = 0; i < NB_ROOTS; i++) {
+    Root* root = &ROOTS[i];
+    int d = base_depth(root->base);
+
+    if (root->base != gen->base || root->depth < depth)
+      continue;
+    for (; d < depth; d++) {
+      Frame* frame = &gen->frames[d];
+      if (root->ext[d] != frame->child / frame->nb_edge_orbits + 1 ||
+          root->orbit[d] != frame->child % frame->nb_edge_orbits)
+        break;
+    }
+    if (d < depth)
+      continue;
+    if (root->depth == depth) {
+      root->found = 1;
+      match |= ROOT_NODE;
+    } else {
+      match |= ROOT_ANCESTOR;
+    }
+  }
+
+  return match;
+}
+
+static int skip_split_node(Generator* gen, int depth, int base) {
+  // Number the nodes at the split level in DFS order, together with the
+  // bases below and the nodes that are completed above that level, and
+  // return whether the node at the given depth is in the residue class of
+  // another job, or is not one of the roots. With --manifest, write the ID of
+  // each of these nodes instead.
+
+  if (depth == SPLIT_LEVEL ||
+      (depth > SPLIT_LEVEL ? base : 2 * depth >= MIN_FACTOR)) {
+    if (MANIFEST) {
+      write_node_id(gen, depth);
+      gen->nb_split_nodes++;
+      return 1;
+    }
+    if (NB_ROOTS)
+      return !(match_roots(gen, depth) & ROOT_NODE);
+    return (int)(gen->nb_split_nodes++ % MOD) != RES;
+  }
+
+  return 0;
+}
+
+static void lock(Generator* gen) {
+  if (THREADS > 1)
+    pthread_mutex_lock(&gen->lock);
+}
+
+static void unlock(Generator* gen) {
+  if (THREADS > 1)
+    pthread_mutex_unlock(&gen->lock);
+}
+
+static inline int claim_next_child(Generator* gen, Frame* frame) {
+  // Mark the next child of the node in the given frame as the one being
+  // explored. Return 0 if the remaining children were stolen by other
+  // threads.
+
+  int claimed;
+
+  lock(gen);
+  claimed = frame->child + 1 < frame->end;
+  if (claimed)
+    frame->child++;
+  unlock(gen);
+
+  return claimed;
+}
+
+static void complete_node(Generator* gen, DoublePreDeco* dpd) {
+  // Complete the double predecoration for the factors 2 * depth - 1 and
+  // 2 * depth that are generated and allowed for its base.
+
+  int depth = dpd->order - 2, nb_vertex_orbits;
+  FILE* written = NULL;
+
+  if (nb_low_degree(dpd) > 3)
+    return;
+
+  for (int f = 2 * depth - 1; f <= 2 * depth; f++) {
+    if (f < MIN_FACTOR || f > FACTOR || nb_bases(f) < gen->base)
+      continue;
+    if (!written) {
+      nb_vertex_orbits =
+          compute_vertex_orbits(gen, dpd, gen->canonical_vertices);
+      if (OUTPUT)
+        gen->planar_code_length = encode_planar_code(gen, dpd);
+    }
+    if (DPD_OUTPUT && OUTFILES[f] != written)
+      write_planar_code(gen, OUTFILES[f], dpd);
+    written = OUTFILES[f];
+
+    gen->factor = f;
+    precount(gen, 1);
+    if (OUTPUT)
+      start_deco_code(gen, f);
+    if (f & 1) {
+      complete_odd(gen, dpd, nb_vertex_orbits, gen->canonical_vertices);
+    } else {
+      complete_even(gen, dpd, nb_vertex_orbits, gen->canonical_vertices);
+    }
+    if (OUTPUT)
+      end_deco_code(gen);
+  }
+}
+
+// Defined with the progress reports, which sample the construction tree
+static void report_progress(Generator* gen);
+
+static double lap(Generator* gen, int order, double mark) {
+  // With --stats, add the time since mark to the given order, and return the
+  // current time. The search calls this when it moves to another frame, so
+  // the time to construct, check and complete the children of a frame is
+  // added to their order.
+
+  double time;
+
+  if (!gen->stats)
+    return 0;
+  time = now();
+  gen->stats[order].seconds += time - mark;
+  return time;
+}
+
+static int visit(Generator* gen, int depth, int base) {
+  // Complete the node in the frame at the given depth if it belongs to this
+  // job, and return whether its children have to be explored.
+
+  int skip = skip_split_node(gen, depth, base);
+
+  if (gen->stats) {
+    gen->stats[depth + 2].nodes++;
+    if (depth == (FACTOR + 1) / 2)
+      gen->stats[depth + 2].leaves++;
+  }
+
+  if (!skip && 2 * depth >= MIN_FACTOR)
+    complete_node(gen, &gen->frames[depth].dpd);
+
+  // Above the split level, only the ancestors of the roots are explored
+  return depth < (FACTOR + 1) / 2 && (!skip || depth < SPLIT_LEVEL) &&
+         (!NB_ROOTS || depth >= SPLIT_LEVEL ||
+          match_roots(gen, depth) & ROOT_ANCESTOR);
+}
+
+static void search(Generator* gen, int root, int depth) {
+  // Continue the depth-first search with the next child of the frame at the
+  // given depth, and return when all children of the frame at depth root are
+  // explored. The frames in between hold the path from root to depth, with
+  // the extensions that still have to be reduced.
+
+  int nb_edge_orbits;
+  Frame* frame = &gen->frames[depth];
+  double mark = gen->stats ? now() : 0;
+
+  lock(gen);
+  gen->root = root;
+  gen->depth = depth + 1;
+  unlock(gen);
+
+  while (1) {
+    if (!claim_next_child(gen, frame)) {
+      mark = lap(gen, frame->dpd.order + 1, mark);
+      // Return to the parent
+      if (depth == root)
+        break;
+      lock(gen);
+      gen->depth = depth--;
+      unlock(gen);
+      frame--;
+      apply_reduction(gen, &frame[1].dpd, frame->ext, frame->edge);
+      CHECK(gen, &frame->dpd);
+      continue;
+    }
+
+    if (CHECKPOINT_REQUEST)
+      checkpoint(gen, depth);
+    if (atomic_load_explicit(&PROGRESS_REQUEST, memory_order_relaxed) &&
+        atomic_exchange(&PROGRESS_REQUEST, 0))
+      report_progress(gen);
+
+    frame->ext = frame->child / frame->nb_edge_orbits + 1;
+    frame->edge = gen->canonical_edges[frame->dpd.order]
+                                      [frame->child % frame->nb_edge_orbits];
+    Frame* next = frame + 1;
+    Stats* stats = gen->stats ? &gen->stats[frame->dpd.order + 1] : NULL;
+
+    if (stats)
+      stats->attempts[frame->ext]++;
+    // Most children are pruned, so the degrees after the extension are
+    // predicted first and only the children that survive are constructed.
+    if (!predict_extension(gen, &frame->dpd, frame->ext, frame->edge,
+                           &next->dpd))
+      continue;
+    int pruned = prune(&next->dpd);
+#ifdef DEBUG
+    int n1 = next->dpd.n1, n2 = next->dpd.n2;
+#endif
+    if (stats) {
+      stats->successes[frame->ext]++;
+      stats->rejects[REJECT_PRUNE] += pruned;
+    }
+    if (pruned)
+      continue;
+
+    copy_predeco(&next->dpd, &frame->dpd);
+    apply_extension(gen, &next->dpd, frame->ext, frame->edge);
+    CHECK(gen, &next->dpd);
+#ifdef DEBUG
+    assert(next->dpd.n1 == n1 && next->dpd.n2 == n2);
+#endif
+
+    nb_edge_orbits = canon(gen, &next->dpd, frame->ext, frame->edge,
+                           gen->canonical_edges[next->dpd.order]);
+    if (nb_edge_orbits && visit(gen, depth + 1, 0)) {
+      mark = lap(gen, next->dpd.order, mark);
+      // Descend to the child
+      lock(gen);
+      next->nb_edge_orbits = nb_edge_orbits;
+      next->child = -1;
+      next->end = 4 * nb_edge_orbits;
+      gen->depth = ++depth + 1;
+      unlock(gen);
+      frame = next;
+      continue;
+    }
+
+    apply_reduction(gen, &next->dpd, frame->ext, frame->edge);
+    CHECK(gen, &frame->dpd);
+  }
+
+  lock(gen);
+  gen->depth = root;
+  unlock(gen);
+}
+
+static int construct_base(Generator* gen, DoublePreDeco* dpd, int base) {
+  // Construct the given base from scratch and return its number of edge
+  // orbits.
+
+  /* First base */
+  dpd->order = dpd->size = 0;
+  dpd->n1 = dpd->n2 = 0;
+  clear_vertices(&dpd->deg1);
+  clear_vertices(&dpd->deg2);
+  clear_vertices(&dpd->deg3);
+
+  int v0 = create_vertex(gen, dpd);
+  int v1 = create_vertex(gen, dpd);
+  int v2 = create_vertex(gen, dpd);
+  Edge edge0 = create_edge(gen, dpd, v0, v1);
+  Edge inverse0 = inverse(edge0);
+  Edge edge1 = create_edge(gen, dpd, v1, v2);
+  Edge inverse1 = inverse(edge1);
+
+  set_next(gen, edge0, edge0);
+  set_next(gen, inverse0, edge1);
+  set_next(gen, edge1, inverse0);
+  set_next(gen, inverse1, inverse1);
+
+  if (base == 1)
+    return canon(gen, dpd, 0, edge0, gen->canonical_edges[dpd->order]);
+
+  /* Second base */
+  int v3 = create_vertex(gen, dpd);
+  Edge edge2 = create_edge(gen, dpd, 0, v3);
+  Edge inverse2 = inverse(edge2);
+  Edge edge3 = create_edge(gen, dpd, v3, v2);
+  Edge inverse3 = inverse(edge3);
+
+  set_next(gen, edge2, edge0);
+  set_next(gen, edge0, edge2);
+  set_next(gen, inverse3, inverse1);
+  set_next(gen, inverse1, inverse3);
+  set_next(gen, edge3, inverse2);
+  set_next(gen, inverse2, edge3);
+
+  if (base == 2)
+    return canon(gen, dpd, 0, edge0, gen->canonical_edges[dpd->order]);
+
+  /* Third base */
+  int v4 = create_vertex(gen, dpd);
+  int v5 = create_vertex(gen, dpd);
+  int v6 = create_vertex(gen, dpd);
+  int v7 = create_vertex(gen, dpd);
+
+  Edge edge4 = create_edge(gen, dpd, v0, v4);
+  Edge inverse4 = inverse(edge4);
+  Edge edge5 = create_edge(gen, dpd, v1, v5);
+  Edge inverse5 = inverse(edge5);
+  Edge edge6 = create_edge(gen, dpd, v2, v6);
+  Edge inverse6 = inverse(edge6);
+  Edge edge7 = create_edge(gen, dpd, v3, v7);
+  Edge inverse7 = inverse(edge7);
+  Edge edge8 = create_edge(gen, dpd, v4, v5);
+  Edge inverse8 = inverse(edge8);
+  Edge edge9 = create_edge(gen, dpd, v5, v6);
+  Edge inverse9 = inverse(edge9);
+  Edge edge10 = create_edge(gen, dpd, v4, v7);
+  Edge inverse10 = inverse(edge10);
+  Edge edge11 = create_edge(gen, dpd, v7, v6);
+  Edge inverse11 = inverse(edge11);
+
+  set_next(gen, edge4, edge0);
+  set_next(gen, edge2, edge4);
+  set_next(gen, edge5, edge1);
+  set_next(gen, inverse0, edge5);
+  set_next(gen, edge6, inverse3);
+  set_next(gen, inverse1, edge6);
+  set_next(gen, edge7, inverse2);
+  set_next(gen, edge3, edge7);
+
+  set_next(gen, edge8, inverse4);
+  set_next(gen, edge10, edge8);
+  set_next(gen, edge9, inverse5);
+  set_next(gen, inverse8, edge9);
+  set_next(gen, inverse4, edge10);
+  set_next(gen, inverse5, inverse8);
+  set_next(gen, inverse11, inverse6);
+  set_next(gen, inverse6, inverse9);
+  set_next(gen, inverse9, inverse11);
+  set_next(gen, inverse10, inverse7);
+  set_next(gen, edge11, inverse10);
+  set_next(gen, inverse7, edge11);
+
+  return canon(gen, dpd, 0, edge0, gen->canonical_edges[dpd->order]);
+}
+
+static int enter_base(Generator* gen, int base) {
+  // Construct the given base in the frame at its depth, and return that
+  // depth.
+
+  DoublePreDeco dpd;
+  int nb_edge_orbits = construct_base(gen, &dpd, base);
+  Frame* frame = &gen->frames[dpd.order - 2];
+
+  CHECK(gen, &dpd);
+  copy_predeco(&frame->dpd, &dpd);
+  frame->nb_edge_orbits = nb_edge_orbits;
+
+  return dpd.order - 2;
+}
+
+static int descend(Generator* gen, int depth, int child) {
+  // Apply the given child of the frame at the given depth to the next frame,
+  // and return its number of edge orbits, or 0 if the child is not in the
+  // construction tree.
+
+  Frame* frame = &gen->frames[depth];
+  Frame* next = frame + 1;
+
+  frame->child = child;
+  frame->end = 4 * frame->nb_edge_orbits;
+  frame->ext = child / frame->nb_edge_orbits + 1;
+  frame->edge = gen->canonical_edges[frame->dpd.order]
+                                    [child % frame->nb_edge_orbits];
+
+  copy_predeco(&next->dpd, &frame->dpd);
+  if (!apply_extension(gen, &next->dpd, frame->ext, frame->edge))
+    return 0;
+  CHECK(gen, &next->dpd);
+
+  return next->nb_edge_orbits =
+             canon(gen, &next->dpd, frame->ext, frame->edge,
+                   gen->canonical_edges[next->dpd.order]);
+}
+
+static void resume(Generator* gen) {
+  // Continue the construction from the checkpoint. The nodes on the stored
+  // path were already numbered before the checkpoint.
+
+  int depth = enter_base(gen, RESUME.base);
+
+  if (depth != RESUME.root)
+    goto mismatch;
+
+  for (;; depth++) {
+    Frame* frame = &gen->frames[depth];
+
+    if (RESUME.orbit[depth] >= frame->nb_edge_orbits)
+      goto mismatch;
+    int child = (RESUME.ext[depth] - 1) * frame->nb_edge_orbits +
+                RESUME.orbit[depth];
+
+    if (depth == RESUME.depth) {
+      frame->child = child - 1;
+      frame->end = 4 * frame->nb_edge_orbits;
+      break;
+    }
+    if (!descend(gen, depth, child))
+      goto mismatch;
+  }
+
+  search(gen, RESUME.root, RESUME.depth);
+  return;
+
+mismatch:
+  fprintf(stderr, "The checkpoint does not match this construction.\n");
+  exit(1);
+}
+
+void start_construction(Generator* gen) {
+  for (int base = RESUMING ? RESUME.base : 1; base <= nb_bases(FACTOR);
+       base++) {
+    lock(gen);
+    gen->base = base;
+    unlock(gen);
+    atomic_store(&STARTED_BASES, base);
+
+    if (RESUMING) {
+      RESUMING = 0;
+      resume(gen);
+      continue;
+    }
+
+    int depth = enter_base(gen, base);
+    if (visit(gen, depth, 1)) {
+      gen->frames[depth].child = -1;
+      gen->frames[depth].end = 4 * gen->frames[depth].nb_edge_orbits;
+      search(gen, depth, depth);
+    }
+  }
+}
+
+static int steal(Generator* gen) {
+  // Take the upper half of the unexplored children of the shallowest node of
+  // a busy generator, and explore them.
+
+  for (int k = 1; k < THREADS; k++) {
+    Generator* victim = GENERATORS[(gen->thread + k) % THREADS];
+
+    lock(victim);
+    for (int depth = victim->root; depth < victim->depth; depth++) {
+      int end = victim->frames[depth].end;
+      int start = end - (end - victim->frames[depth].child) / 2;
+
+      if (start < end) {
+        int path[MAXORDER];
+
+        victim->frames[depth].end = start;
+        atomic_fetch_add(&ACTIVE, 1);
+
+        gen->base = victim->base;
+        for (int d = 0; d < depth; d++)
+          path[d] = victim->frames[d].child;
+        unlock(victim);
+
+        // Reconstruct the node along the path of the victim, which was
+        // already counted by the victim
+        Stats* stats = gen->stats;
+        gen->stats = NULL;
+        for (int d = enter_base(gen, gen->base); d < depth; d++) {
+          int nb_edge_orbits = descend(gen, d, path[d]);
+          assert(nb_edge_orbits > 0);
+          (void)nb_edge_orbits;
+        }
+        gen->stats = stats;
+
+        gen->frames[depth].child = start - 1;
+        gen->frames[depth].end = end;
+        search(gen, depth, depth);
+
+        lock(gen);
+        gen->root = gen->depth = 0;
+        unlock(gen);
+
+        atomic_fetch_sub(&ACTIVE, 1);
+        return 1;
+      }
+    }
+    unlock(victim);
+  }
+
+  return 0;
+}
+
+static void* work(void* arg) {
+  Generator* gen = arg;
+
+  if (gen->thread == 0) {
+    start_construction(gen);
+
+    lock(gen);
+    gen->root = gen->depth = 0;
+    unlock(gen);
+
+    atomic_fetch_sub(&ACTIVE, 1);
+  }
+
+  while (atomic_load(&ACTIVE) > 0) {
+    if (!steal(gen))
+      nanosleep(&(struct timespec){0, 100000}, NULL);
+  }
+
+  return NULL;
+}
+
+static void run_threads() {
+  // Explore the construction tree with THREADS generators that steal work
+  // from each other.
+
+  pthread_t threads[THREADS];
+
+  atomic_store(&ACTIVE, 1);
+  for (int i = 0; i < THREADS; i++)
+    pthread_create(&threads[i], NULL, work, GENERATORS[i]);
+  for (int i = 0; i < THREADS; i++)
+    pthread_join(threads[i], NULL);
+}
+
+/* Estimation */
+
+static int tree_children(Generator* gen, int depth, int* children) {
+  // Store the children of the node in the frame at the given depth that are
+  // in the construction tree, and return their number.
+
+  Frame* frame = &gen->frames[depth];
+  Frame* next = frame + 1;
+  int nb_children = 0;
+
+  for (int child = 0; child < 4 * frame->nb_edge_orbits; child++) {
+    int ext = child / frame->nb_edge_orbits + 1;
+    Edge edge = gen->canonical_edges[frame->dpd.order]
+                                    [child % frame->nb_edge_orbits];
+
+    copy_predeco(&next->dpd, &frame->dpd);
+    if (!apply_extension(gen, &next->dpd, ext, edge))
+      continue;
+    if (!prune(&next->dpd) && canon(gen, &next->dpd, ext, edge,
+                                    gen->canonical_edges[next->dpd.order]))
+      children[nb_children++] = child;
+    apply_reduction(gen, &next->dpd, ext, edge);
+  }
+
+  return nb_children;
+}
+
+static double probe(Generator* gen,
+                    int base,
+                    double* counts,
+                    double* precounts,
+                    double* weights) {
+  // Follow a random path from the given base down to a leaf, and add the
+  // Knuth estimates of the counts of its whole subtree to the given arrays.
+  // Every node on the path stands for as many nodes as the product of the
+  // numbers of children of the nodes above it, which is stored in weights
+  // at its depth, and 0 at the other depths. Return the estimated time. With
+  // NULL counts, the nodes are not completed and only the weights are set.
+
+  int children[4 * MAXSIZE];
+  int depth = enter_base(gen, base);
+  double weight = 1, time = 0;
+
+  for (int d = 0; d < MAXORDER; d++)
+    weights[d] = 0;
+
+  gen->base = base;
+  while (1) {
+    double start = now();
+    int nb_children = 0;
+
+    weights[depth] = weight;
+    for (int f = MIN_FACTOR; f <= FACTOR; f++)
+      gen->count[f] = gen->precount[f] = 0;
+    if (counts && 2 * depth >= MIN_FACTOR)
+      complete_node(gen, &gen->frames[depth].dpd);
+    if (depth < (FACTOR + 1) / 2)
+      nb_children = tree_children(gen, depth, children);
+    time += weight * (now() - start);
+
+    for (int f = MIN_FACTOR; f <= FACTOR && counts; f++) {
+      counts[f] += weight * gen->count[f];
+      precounts[f] += weight * gen->precount[f];
+    }
+
+    if (nb_children == 0)
+      return time;
+    descend(gen, depth, children[lrand48() % nb_children]);
+    weight *= nb_children;
+    depth++;
+  }
+}
+
+static double interval(double sum, double squares) {
+  // Return the half width of the 95% confidence interval of the mean of
+  // ESTIMATE samples with the given sum and sum of squares.
+
+  double mean = sum / ESTIMATE;
+
+  return 1.96 * sqrt(fmax(squares / ESTIMATE - mean * mean, 0) / ESTIMATE);
+}
+
+static void estimate(Generator* gen) {
+  // Estimate the counts and the run time with one thread from ESTIMATE random
+  // paths. The estimates are unbiased, but their distribution has a long
+  // tail, so the confidence intervals are only reliable for many paths.
+
+  double counts[FACTOR + 1], precounts[FACTOR + 1];
+  double sum[2][FACTOR + 1], squares[2][FACTOR + 1];
+  double seconds, seconds_sum = 0, seconds_squares = 0;
+  double weights[MAXORDER];
+
+  memset(sum, 0, sizeof(sum));
+  memset(squares, 0, sizeof(squares));
+  srand48(SEED >= 0 ? SEED : time(NULL) ^ getpid());
+
+  for (int i = 0; i < ESTIMATE; i++) {
+    memset(counts, 0, sizeof(counts));
+    memset(precounts, 0, sizeof(precounts));
+    seconds = 0;
+    for (int base = 1; base <= nb_bases(FACTOR); base++)
+      seconds += probe(gen, base, counts, precounts, weights);
+    seconds_sum += seconds;
+    seconds_squares += seconds * seconds;
+    for (int f = MIN_FACTOR; f <= FACTOR; f++) {
+      sum[0][f] += 2 * counts[f];
+      squares[0][f] += 4 * counts[f] * counts[f];
+      sum[1][f] += precounts[f];
+      squares[1][f] += precounts[f] * precounts[f];
+    }
+  }
+
+  fprintf(stderr, "Estimated from %d random paths, with 95%% confidence:\n",
+          ESTIMATE);
+  for (int f = MIN_FACTOR; f <= FACTOR; f++) {
+    if (ALL)
+      fprintf(stderr, "%d: ", f);
+    fprintf(stderr, "%.4g +- %.2g decorations (%.4g +- %.2g predecorations)\n",
+            sum[0][f] / ESTIMATE, interval(sum[0][f], squares[0][f]),
+            sum[1][f] / ESTIMATE, interval(sum[1][f], squares[1][f]));
+  }
+  fprintf(stderr, "%.4g +- %.2g seconds with one thread\n",
+          seconds_sum / ESTIMATE, interval(seconds_sum, seconds_squares));
+}
+
+typedef struct {
+  // The estimates of choose_split for each level: the number of units, the
+  // sum of their sizes and the sum of the squares of their sizes. The units
+  // above the frontier are enumerated, and the size of the current unit of
+  // each level is estimated from two independent groups of paths.
+  double nodes[MAXORDER];
+  double sum[MAXORDER];
+  double squares[MAXORDER];
+  double size[2][MAXORDER];
+  int frontier;
+  int pairs;  // The number of pairs of paths below each frontier node
+} Split;
+
+static void ascend(Generator* gen, int depth, int target) {
+  // Reduce the node in the frame at the given depth to its ancestor in the
+  // frame at the target depth.
+
+  for (int d = depth - 1; d >= target; d--)
+    apply_reduction(gen, &gen->frames[d + 1].dpd, gen->frames[d].ext,
+                    gen->frames[d].edge);
+}
+
+static double walk(Generator* gen, int depth, double* weights) {
+  // Follow a random path from the node in the frame at the given depth down
+  // to a leaf, and return to the node. The children of the path stay in the
+  // frames. Store the product of the numbers of children above each node of
+  // the path in weights at its depth, and 0 at the deeper levels that the
+  // path does not reach. Return the Knuth estimate of the size of the
+  // subtree.
+
+  int children[4 * MAXSIZE], leaf = (FACTOR + 1) / 2, d = depth;
+  double weight = 1, size = 0;
+
+  for (int l = depth; l <= leaf; l++)
+    weights[l] = 0;
+
+  while (1) {
+    int nb_children = d < leaf ? tree_children(gen, d, children) : 0;
+
+    weights[d] = weight;
+    size += weight;
+    if (nb_children == 0)
+      break;
+    descend(gen, d, children[lrand48() % nb_children]);
+    weight *= nb_children;
+    d++;
+  }
+  ascend(gen, d, depth);
+
+  return size;
+}
+
+static int count_level(Generator* gen, int depth, int level, int limit) {
+  // Return the number of nodes at the given level in the subtree of the node
+  // in the frame at the given depth, or a number above limit if there are
+  // more.
+
+  int children[4 * MAXSIZE], nb_children, count = 0;
+
+  if (depth >= level)
+    return depth == level;
+
+  nb_children = tree_children(gen, depth, children);
+  for (int i = 0; i < nb_children && count <= limit; i++) {
+    descend(gen, depth, children[i]);
+    count += count_level(gen, depth + 1, level, limit - count);
+    ascend(gen, depth + 1, depth);
+  }
+
+  return count;
+}
+
+static int count_nodes(Generator* gen, int level, int limit) {
+  // Return the number of nodes at the given level below all bases, or a
+  // number above limit if there are more.
+
+  int count = 0;
+
+  for (int base = 1; base <= nb_bases(FACTOR) && count <= limit; base++) {
+    gen->base = base;
+    count += count_level(gen, enter_base(gen, base), level, limit - count);
+  }
+
+  return count;
+}
+
+static void end_units(Split* split, int level) {
+  // Add the current units of the given level and the deeper levels up to the
+  // frontier to the estimates. The product of the two independent estimates
+  // of the size of a unit estimates its square without bias.
+
+  for (int l = level; l <= split->frontier; l++) {
+    if (split->size[0][l] > 0) {
+      split->nodes[l]++;
+      split->sum[l] += (split->size[0][l] + split->size[1][l]) / 2;
+      split->squares[l] += split->size[0][l] * split->size[1][l];
+    }
+    split->size[0][l] = split->size[1][l] = 0;
+  }
+}
+
+static void sample_below(Generator* gen, Split* split, int depth) {
+  // Estimate the units below the frontier node in the frame at the given
+  // depth from pairs of paths. The paths of a pair give two independent
+  // estimates of the size of the node, which are added to its current units.
+  // The square of the size of a unit on a path is estimated with another
+  // path below the unit.
+
+  double weights[MAXORDER], below[MAXORDER + 1], again[MAXORDER];
+  int path[MAXORDER], leaf = (FACTOR + 1) / 2, samples = 2 * split->pairs;
+
+  for (int i = 0; i < samples; i++) {
+    double size = walk(gen, depth, weights);
+
+    for (int l = 0; l <= depth; l++)
+      split->size[i % 2][l] += size / split->pairs;
+
+    below[leaf + 1] = 0;
+    for (int l = leaf; l >= depth; l--)
+      below[l] = below[l + 1] + weights[l];
+    for (int l = depth; l < leaf; l++)
+      path[l] = gen->frames[l].child;
+
+    for (int l = depth + 1; l <= leaf && weights[l] > 0; l++) {
+      split->nodes[l] += weights[l] / samples;
+      split->sum[l] += below[l] / samples;
+      for (int d = depth; d < l; d++)
+        descend(gen, d, path[d]);
+      split->squares[l] += below[l] * walk(gen, l, again) / samples;
+      ascend(gen, l, depth);
+    }
+  }
+}
+
+static void enumerate_units(Generator* gen, Split* split, int depth) {
+  // Add the node in the frame at the given depth, and its subtree, to the
+  // units of all levels. The node starts a unit of its own level, and
+  // belongs to the current units of the levels above it.
+
+  int children[4 * MAXSIZE], nb_children;
+
+  end_units(split, depth);
+  if (depth == split->frontier) {
+    sample_below(gen, split, depth);
+    return;
+  }
+
+  for (int l = 0; l <= depth; l++) {
+    split->size[0][l]++;
+    split->size[1][l]++;
+  }
+  nb_children = tree_children(gen, depth, children);
+  for (int i = 0; i < nb_children; i++) {
+    descend(gen, depth, children[i]);
+    enumerate_units(gen, split, depth + 1);
+    ascend(gen, depth + 1, depth);
+  }
+}
+
+static void choose_split(Generator* gen) {
+  // Print the shallowest split level with at least CHOOSE_SPLIT * MOD
+  // balanced units. Units with sizes s_i count as (sum s_i)^2 / sum s_i^2
+  // balanced units: all of them if they have the same size, and about one if
+  // a single unit dominates. The sizes are the numbers of nodes of the
+  // subtrees, and a base below a level is one unit of it. The tree is
+  // enumerated down to the frontier, the deepest level with at most
+  // SPLIT_FRONTIER nodes below all bases, and the sizes below it are
+  // estimated from at least SPLIT_SAMPLES pairs of random paths. Without
+  // --seed, the paths use seed 0, so that the level can be reproduced.
+
+  Split split;
+  int leaf = (FACTOR + 1) / 2, bases = nb_bases(FACTOR), level, best = 0;
+  int count;
+  double units[MAXORDER];
+
+  memset(&split, 0, sizeof(split));
+  srand48(SEED >= 0 ? SEED : 0);
+
+  // The frontier is not above the root of the last base
+  split.frontier = enter_base(gen, bases);
+  while (split.frontier < leaf) {
+    count = count_nodes(gen, split.frontier + 1, SPLIT_FRONTIER);
+    if (count == 0 || count > SPLIT_FRONTIER)
+      break;
+    split.frontier++;
+  }
+  count = count_nodes(gen, split.frontier, SPLIT_SAMPLES);
+  split.pairs = count < SPLIT_SAMPLES ? (SPLIT_SAMPLES + count - 1) / count : 1;
+
+  for (int base = 1; base <= bases; base++) {
+    gen->base = base;
+    end_units(&split, 0);
+    enumerate_units(gen, &split, enter_base(gen, base));
+  }
+  end_units(&split, 0);
+
+  for (level = 0; level <= leaf; level++) {
+    units[level] = split.squares[level]
+                       ? split.sum[level] * split.sum[level] /
+                             split.squares[level]
+                       : 0;
+    fprintf(stderr, "level %d: %.3g nodes, %.3g balanced units\n", level,
+            split.nodes[level], units[level]);
+    if (units[level] > units[best])
+      best = level;
+  }
+
+  // Without enough units, take the level with the most
+  for (level = 0; level <= leaf; level++)
+    if (units[level] >= (double)CHOOSE_SPLIT * MOD)
+      break;
+  printf("%d\n", level <= leaf ? level : best);
+}
+
+static int shares_output(int factor) {
+  // Return whether the factor is written to the output of the previous one.
+
+  return factor > MIN_FACTOR && (!OUTFILENAME || !strstr(OUTFILENAME, "%d"));
+}
+
+static void output_filename(char* filename, int size, int factor) {
+  // Write the name of the output file of the given factor, which is
+  // OUTFILENAME with %d replaced by the factor, to filename.
+
+  char* split = strstr(OUTFILENAME, "%d");
+
+  if (split)
+    snprintf(filename, size, "%.*s%d%s", (int)(split - OUTFILENAME),
+             OUTFILENAME, factor, split + 2);
+  else
+    snprintf(filename, size, "%s", OUTFILENAME);
+}
+
+static void write_header(FILE* file) {
+  // Orders above 255 are written in the 16-bit variant
+  if (OUTPUT)
+    write_deco_header(file, (FACTOR + 1) / 2 + 2 > 255);
+  if (DPD_OUTPUT)
+    write_planar_header(file, (FACTOR + 1) / 2 + 2 > 255);
+}
+
+static FILE* open_output(int factor) {
+  // Open the output file of the given factor, with %d in its name replaced by
+  // the factor. When resuming, drop the output written after the checkpoint.
+
+  char filename[strlen(OUTFILENAME) + 16];
+  long offset = RESUMING ? RESUME.offset[factor] : 0;
+  FILE* file;
+
+  output_filename(filename, sizeof(filename), factor);
+
+  if (!RESUMING) {
+    file = fopen(filename, "w");
+  } else if (offset < 0) {
+    // The position of the output was unknown when the checkpoint was made
+    fprintf(stderr, "The checkpoint does not record the end of %s\n",
+            filename);
+    return NULL;
+  } else if ((file = fopen(filename, "r+"))) {
+    if (ftruncate(fileno(file), offset)) {
+      fclose(file);
+      file = NULL;
+    } else {
+      fseek(file, 0, SEEK_END);
+    }
+  }
+
+  if (!file)
+    fprintf(stderr, "Could not open %s\n", filename);
+
+  return file;
+}
+
+/* Progress */
+
+static void request_progress(int signal) {
+  (void)signal;
+  atomic_store(&PROGRESS_REQUEST, 1);
+}
+
+static void* progress_timer(void* arg) {
+  sigset_t signals;
+
+  // SIGUSR1 has to interrupt the main thread when it waits for workers
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGUSR1);
+  pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+  (void)arg;
+  while (1) {
+    sleep(PROGRESS_INTERVAL);
+    atomic_store(&PROGRESS_REQUEST, 1);
+  }
+
+  return NULL;
+}
+
+static void start_progress() {
+  // Report the progress on SIGUSR1, and every PROGRESS_INTERVAL seconds if
+  // it is set.
+
+  pthread_t timer;
+
+  START_TIME = now();
+  if (!(ESTIMATE || CHOOSE_SPLIT || MANIFEST || WORKERS || COORDINATOR))
+    PROGRESS_REPLAY = create_generator();
+  signal(SIGUSR1, request_progress);
+  if (PROGRESS_INTERVAL && !pthread_create(&timer, NULL, progress_timer, NULL))
+    pthread_detach(timer);
+}
+
+static void weigh_bases(Generator* gen) {
+  // Estimate the share of each base in the construction tree from random
+  // paths, for at most a tenth of a second. The paths do not complete their
+  // nodes, since the other threads may be writing output, so the shares are
+  // in nodes.
+
+  double weights[MAXORDER], nodes[4] = {0}, total = 0, start = now();
+  int bases = nb_bases(FACTOR);
+
+  for (int i = 0; i < PROGRESS_SAMPLES && now() - start < 0.1; i++) {
+    for (int base = 1; base <= bases; base++) {
+      probe(gen, base, NULL, NULL, weights);
+      for (int d = 0; d < MAXORDER; d++)
+        nodes[base] += weights[d];
+    }
+  }
+
+  for (int base = 1; base <= bases; base++)
+    total += nodes[base];
+  for (int base = 1; base <= bases; base++)
+    BASE_WEIGHTS[base] = total > 0 ? nodes[base] / total : 1.0 / bases;
+}
+
+static void weigh_replay() {
+  weigh_bases(PROGRESS_REPLAY);
+}
+
+static double remaining(Generator* gen, Generator* replay) {
+  // Return the fraction of the construction tree that the generator still
+  // has to explore, as if all children of a node in the tree had equally
+  // large subtrees. The path of the generator is replayed in replay to find
+  // the children in the tree. The frames above its root hold the path to the
+  // part it was given.
+
+  int path[MAXORDER], end[MAXORDER], children[4 * MAXSIZE];
+  int base, root, depth;
+  double weight, rest = 0;
+
+  lock(gen);
+  base = gen->base;
+  root = gen->root;
+  depth = gen->depth;
+  for (int d = 0; d < depth; d++) {
+    path[d] = gen->frames[d].child;
+    end[d] = gen->frames[d].end;
+  }
+  unlock(gen);
+
+  if (depth == 0)
+    return 0;
+
+  weight = BASE_WEIGHTS[base];
+  for (int d = enter_base(replay, base); d < depth; d++) {
+    int nb_children = tree_children(replay, d, children), later = 0;
+
+    if (nb_children == 0)
+      break;
+    for (int i = 0; i < nb_children; i++)
+      later += children[i] > path[d] && children[i] < end[d];
+    if (d >= root)
+      rest += weight * later / nb_children;
+    weight /= nb_children;
+
+    if (d + 1 < depth && !descend(replay, d, path[d]))
+      break;
+  }
+
+  return rest;
+}
+
+static void format_duration(char* text, int size, double seconds) {
+  int s = seconds;
+
+  if (s >= 3600)
+    snprintf(text, size, "%dh%02dm%02ds", s / 3600, s / 60 % 60, s % 60);
+  else if (s >= 60)
+    snprintf(text, size, "%dm%02ds", s / 60, s % 60);
+  else
+    snprintf(text, size, "%ds", s);
+}
+
+__attribute__((noinline, cold))
+static void report_progress(Generator* gen) {
+  // Write the counts so far, the throughput and an estimate of the fraction
+  // of the construction tree that is done to stderr. A worker of a
+  // coordinator reports on the part that gen is generating. Like checkpoint,
+  // this is kept out of the search loop.
+
+  static pthread_mutex_t reporting = PTHREAD_MUTEX_INITIALIZER;
+  Generator** gens = CONNECT ? &gen : GENERATORS;
+  int nb_gens = CONNECT ? 1 : THREADS;
+  unsigned long long count = 0, precount = 0;
+  double rest = 0, seconds = now() - START_TIME, done;
+  char elapsed[32], eta[32];
+
+  // The bases are weighed once, before the reporting mutex is taken
+  pthread_once(&WEIGHED, weigh_replay);
+  pthread_mutex_lock(&reporting);
+
+  for (int i = 0; i < nb_gens; i++) {
+    lock(gens[i]);
+    for (int f = MIN_FACTOR; f <= FACTOR; f++) {
+      count += get_count(gens[i], f);
+      precount += get_precount(gens[i], f);
+    }
+    unlock(gens[i]);
+    rest += remaining(gens[i], PROGRESS_REPLAY);
+  }
+  for (int base = atomic_load(&STARTED_BASES) + 1; base <= nb_bases(FACTOR);
+       base++)
+    rest += BASE_WEIGHTS[base];
+
+  done = 1 - rest;
+  format_duration(elapsed, sizeof(elapsed), seconds);
+  format_duration(eta, sizeof(eta),
+                  done > 0 ? seconds * (1 - done) / done : 0);
+  if (CONNECT)
+    fprintf(stderr, "part %d: ", RES);
+  fprintf(stderr,
+          "%llu decorations (%llu predecorations), %.0f decorations/s, "
+          "%.1f%% done, %s elapsed, ETA %s\n",
+          2 * count, precount, seconds > 0 ? 2 * count / seconds : 0,
+          100 * done, elapsed, done > 0 ? eta : "unknown");
+  pthread_mutex_unlock(&reporting);
+}
+
+static void report_parts(int nb_done, int nb_skipped) {
+  // Write the summed counts of the finished parts and the number of parts
+  // that are done to stderr. The ETA assumes that the other parts take as
+  // long as the parts that were finished in this run, which are all but
+  // nb_skipped of them.
+
+  unsigned long long count = 0, precount = 0;
+  double seconds = now() - START_TIME;
+  int nb_finished = nb_done - nb_skipped;
+  char elapsed[32], eta[32];
+
+  for (int f = MIN_FACTOR; f <= FACTOR; f++) {
+    count += get_count(GENERATORS[0], f);
+    precount += get_precount(GENERATORS[0], f);
+  }
+
+  format_duration(elapsed, sizeof(elapsed), seconds);
+  format_duration(eta, sizeof(eta),
+                  nb_finished > 0 ? seconds * (MOD - nb_done) / nb_finished
+                                  : 0);
+  fprintf(stderr,
+          "%llu decorations (%llu predecorations), %d of %d parts done, "
+          "%s elapsed, ETA %s\n",
+          2 * count, precount, nb_done, MOD, elapsed,
+          nb_finished > 0 ? eta : "unknown");
+}
+
+static int progress_timeout() {
+  // Return the timeout in milliseconds for a poll that has to notice the
+  // progress requests of the timer.
+
+  return PROGRESS_INTERVAL ? 1000 : -1;
+}
+
+/* Worker processes */
+
+typedef struct {
+  pid_t pid;
+  int commands;  // The pipe that sends parts to the worker
+  int results;   // The pipe that receives the entry of a part
+  int part;      // The part that is being generated, or -1
+} Worker;
+
+static int write_all(int fd, const void* data, size_t size) {
+  const char* p = data;
+
+  while (size > 0) {
+    ssize_t n = write(fd, p, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return 0;
+    p += n;
+    size -= n;
+  }
+
+  return 1;
+}
+
+static int read_all(int fd, void* data, size_t size) {
+  char* p = data;
+
+  while (size > 0) {
+    ssize_t n = read(fd, p, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return 0;
+    p += n;
+    size -= n;
+  }
+
+  return 1;
+}
+
+static void shard_filename(char* filename, int size, int factor, int part) {
+  // With an output file, part RES of it is written to OUTFILE.RES. Otherwise
+  // the parts are written to SHARD_DIR and merged to stdout.
+
+  if (OUTFILENAME) {
+    output_filename(filename, size, factor);
+    snprintf(filename + strlen(filename), size - strlen(filename), ".%d",
+             part);
+  } else {
+    snprintf(filename, size, "%s/%d", SHARD_DIR, part);
+  }
+}
+
+static int generate_part(int part, LedgerEntry* entry) {
+  // Generate the part into its own output files, and store its counts and
+  // the time it took in entry. Return whether the output was written
+  // completely.
+
+  double start = now();
+  int written = 1;
+  Generator* gen;
+
+  // A worker of a coordinator reports the progress of the part
+  RES = part;
+  START_TIME = start;
+  for (int f = MIN_FACTOR; f <= FACTOR && (OUTPUT || DPD_OUTPUT); f++) {
+    char filename[strlen(OUTFILENAME ? OUTFILENAME : SHARD_DIR) + 32];
+
+    if (shares_output(f)) {
+      OUTFILES[f] = OUTFILES[f - 1];
+      continue;
+    }
+    shard_filename(filename, sizeof(filename), f, part);
+    if (!(OUTFILES[f] = fopen(filename, "w"))) {
+      fprintf(stderr, "Could not open %s\n", filename);
+      return 0;
+    }
+    // The merged stream has a single header
+    if (OUTFILENAME)
+      write_header(OUTFILES[f]);
+  }
+
+  gen = create_generator();
+  if (OUTPUT)
+    create_deco_buffers(gen, OUTFILES, MIN_FACTOR, FACTOR);
+  start_construction(gen);
+  free_deco_buffers(gen);
+  entry->part = part;
+  for (int f = 1; f <= FACTOR; f++) {
+    entry->count[f] = get_count(gen, f);
+    entry->precount[f] = get_precount(gen, f);
+  }
+  free_generator(gen);
+
+  for (int f = MIN_FACTOR; f <= FACTOR && (OUTPUT || DPD_OUTPUT); f++) {
+    if (!shares_output(f) && fclose(OUTFILES[f]))
+      written = 0;
+  }
+  entry->seconds = now() - start;
+
+  return written;
+}
+
+static void add_entry(LedgerEntry* entry) {
+  // Add the counts of a finished part to the first generator.
+
+  for (int f = MIN_FACTOR; f <= FACTOR; f++) {
+    GENERATORS[0]->count[f] += entry->count[f];
+    GENERATORS[0]->precount[f] += entry->precount[f];
+  }
+}
+
+static void serve_parts(int commands, int results) {
+  // Generate the parts that are received on commands, and send the entry of
+  // each part back on results, until commands is closed.
+
+  LedgerEntry entry;
+  int part;
+
+  while (read_all(commands, &part, sizeof(part))) {
+    if (!generate_part(part, &entry) ||
+        !write_all(results, &entry, sizeof(entry)))
+      _exit(1);
+  }
+
+  _exit(0);
+}
+
+static int start_worker(Worker* workers, int nb_workers, int i) {
+  // Fork a new worker process into workers[i]. Return whether it was started.
+
+  int commands[2], results[2];
+  pid_t pid;
+
+  if (pipe(commands))
+    return 0;
+  if (pipe(results)) {
+    close(commands[0]);
+    close(commands[1]);
+    return 0;
+  }
+
+  // Do not write the buffered output twice
+  fflush(NULL);
+  if ((pid = fork()) == 0) {
+    // Another worker only sees the end of its pipes when they are closed here
+    for (int j = 0; j < nb_workers; j++) {
+      if (j != i && workers[j].pid > 0) {
+        if (workers[j].commands >= 0)
+          close(workers[j].commands);
+        close(workers[j].results);
+      }
+    }
+    close(commands[1]);
+    close(results[0]);
+    // The parent reports the progress of all workers
+    signal(SIGUSR1, SIG_IGN);
+    atomic_store(&PROGRESS_REQUEST, 0);
+    serve_parts(commands[0], results[1]);
+  }
+  close(commands[0]);
+  close(results[1]);
+  if (pid < 0) {
+    close(commands[1]);
+    close(results[0]);
+    return 0;
+  }
+
+  workers[i] = (Worker){pid, commands[1], results[0], -1};
+  return 1;
+}
+
+static void give_part(Worker* worker, int part) {
+  // Send the part to the worker, or let it exit if there are no parts left. A
+  // failed write is detected when its results are read.
+
+  worker->part = part;
+  if (part >= 0) {
+    write_all(worker->commands, &part, sizeof(part));
+  } else {
+    close(worker->commands);
+    worker->commands = -1;
+  }
+}
+
+static int merge_shard(int part) {
+  // Append the output of the part to stdout, and remove it.
+
+  char filename[strlen(SHARD_DIR) + 32], data[1 << 16];
+  FILE* file;
+  size_t n;
+
+  shard_filename(filename, sizeof(filename), MIN_FACTOR, part);
+  if (!(file = fopen(filename, "r"))) {
+    fprintf(stderr, "Could not open %s\n", filename);
+    return 0;
+  }
+  while ((n = fread(data, 1, sizeof(data), file)) > 0)
+    fwrite(data, 1, n, stdout);
+  fclose(file);
+  unlink(filename);
+
+  return 1;
+}
+
+static int run_workers() {
+  // Generate the MOD parts with WORKERS processes. A worker gets the next
+  // part from the queue when it has finished the previous one, so the parts
+  // do not have to be equally large. The counts of the parts are added to the
+  // first generator. The part of a worker that dies is generated again by a
+  // new worker, at most MAX_ATTEMPTS times. Return whether all parts were
+  // generated.
+
+  int nb_workers = WORKERS < MOD ? WORKERS : MOD;
+  int merge = !OUTFILENAME && (OUTPUT || DPD_OUTPUT);
+  int next = 0, nb_done = 0, merged = 0, success = 1;
+  int* attempts;
+  char* done;
+  static LedgerEntry entry;
+  Worker workers[nb_workers];
+  struct pollfd fds[nb_workers];
+
+  if (merge) {
+    const char* tmpdir = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+
+    SHARD_DIR = malloc(strlen(tmpdir) + 32);
+    sprintf(SHARD_DIR, "%s/doubledecogen.XXXXXX", tmpdir);
+    if (!mkdtemp(SHARD_DIR)) {
+      fprintf(stderr, "Could not create a directory in %s\n", tmpdir);
+      free(SHARD_DIR);
+      return 0;
+    }
+  }
+  attempts = calloc(MOD, sizeof(int));
+  done = calloc(MOD, 1);
+
+  // A worker that dies while a part is sent to it is handled below
+  signal(SIGPIPE, SIG_IGN);
+
+  for (int i = 0; i < nb_workers; i++)
+    workers[i].pid = 0;
+  for (int i = 0; i < nb_workers && success; i++) {
+    if (!(success = start_worker(workers, nb_workers, i)))
+      fprintf(stderr, "Could not start worker %d\n", i);
+    else
+      give_part(&workers[i], next++);
+  }
+
+  while (success && nb_done < MOD) {
+    if (atomic_exchange(&PROGRESS_REQUEST, 0))
+      report_parts(nb_done, 0);
+
+    for (int i = 0; i < nb_workers; i++) {
+      fds[i].fd = workers[i].pid > 0 ? workers[i].results : -1;
+      fds[i].events = POLLIN;
+    }
+    if (poll(fds, nb_workers, progress_timeout()) < 0) {
+      if (errno == EINTR)
+        continue;
+      success = 0;
+      break;
+    }
+
+    for (int i = 0; i < nb_workers && success; i++) {
+      Worker* worker = &workers[i];
+      int part = worker->part, status;
+
+      if (!fds[i].revents)
+        continue;
+
+      if (read_all(worker->results, &entry, sizeof(entry))) {
+        add_entry(&entry);
+        done[entry.part] = 1;
+        nb_done++;
+        while (merge && merged < MOD && done[merged] && success)
+          success = merge_shard(merged++);
+        give_part(worker, next < MOD ? next++ : -1);
+        continue;
       }
-      reduction(&copy, edge);
-      CHECK(dpd);
+
+      // The worker has exited
+      close(worker->results);
+      if (worker->commands >= 0)
+        close(worker->commands);
+      waitpid(worker->pid, &status, 0);
+      worker->pid = 0;
+      if (part < 0)
+        continue;
+
+      // Generate its part again with a new worker
+      if (WIFSIGNALED(status))
+        fprintf(stderr, "The worker of part %d was killed by signal %d\n",
+                part, WTERMSIG(status));
+      else
+        fprintf(stderr, "The worker of part %d failed\n", part);
+      if (++attempts[part] >= MAX_ATTEMPTS) {
+        fprintf(stderr, "Part %d failed %d times\n", part, MAX_ATTEMPTS);
+        success = 0;
+      } else if (!start_worker(workers, nb_workers, i)) {
+        fprintf(stderr, "Could not start worker %d\n", i);
+        success = 0;
+      } else {
+        give_part(worker, part);
+      }
+    }
+  }
+
+  for (int i = 0; i < nb_workers; i++) {
+    if (workers[i].pid <= 0)
+      continue;
+    if (!success)
+      kill(workers[i].pid, SIGTERM);
+    if (workers[i].commands >= 0)
+      close(workers[i].commands);
+    close(workers[i].results);
+    waitpid(workers[i].pid, NULL, 0);
+  }
+
+  if (merge) {
+    char filename[strlen(SHARD_DIR) + 32];
+
+    // Remove the output of the parts that were not merged
+    for (int part = merged; part < MOD; part++) {
+      shard_filename(filename, sizeof(filename), MIN_FACTOR, part);
+      unlink(filename);
     }
+    rmdir(SHARD_DIR);
+    free(SHARD_DIR);
   }
+
+  free(attempts);
+  free(done);
+
+  return success;
 }
 
-void grow(DoublePreDeco* dpd, int nb_edge_orbits) {
-  if (dpd->order - 2 == (FACTOR + 1) / 2) {
-    // Complete the double predecoration
-    if (dpd->n1 + dpd->n2 <= 3) {
-      precount(1);
-      int nb_vertex_orbits = compute_vertex_orbits(dpd, CANONICAL_VERTICES);
-      if (DPD_OUTPUT)
-        write_planar_code(OUTFILE, dpd);
-      if (FACTOR & 1) {
-        complete_odd(dpd, nb_vertex_orbits, CANONICAL_VERTICES);
-      } else {
-        complete_even(dpd, nb_vertex_orbits, CANONICAL_VERTICES);
+/* Coordinator */
+
+typedef struct {
+  int fd;
+  int part;   // The part that is being generated, or -1
+  int ready;  // Whether the worker has the same options
+  char* input;
+  size_t length;
+  size_t capacity;
+} Connection;
+
+enum { TODO, BUSY, DONE };
+
+static void hello(char* line, int size) {
+  // A worker introduces itself with the options that determine the parts.
+
+  snprintf(line, size,
+           "hello factor %d mod %d split %d lsp %d connectivity %d all %d\n",
+           FACTOR, MOD, SPLIT_LEVEL, get_filter_lsp(), get_connectivity(),
+           ALL);
+}
+
+static int handle_line(Connection* connection,
+                       char* line,
+                       char* state,
+                       int* nb_done,
+                       FILE* ledger) {
+  // Handle a line from a worker. Return whether the worker follows the
+  // protocol.
+
+  static LedgerEntry entry;
+  char expected[128];
+
+  if (!connection->ready) {
+    hello(expected, sizeof(expected));
+    if (strcmp(line, expected)) {
+      write_all(connection->fd, "error options\n", 14);
+      return 0;
+    }
+    connection->ready = 1;
+    return 1;
+  }
+
+  if (parse_ledger_entry(line, FACTOR, &entry) ||
+      entry.part != connection->part)
+    return 0;
+
+  connection->part = -1;
+  if (state[entry.part] == DONE)
+    return 1;
+  state[entry.part] = DONE;
+  (*nb_done)++;
+  add_entry(&entry);
+  if (ledger && write_ledger_entry(ledger, FACTOR, &entry))
+    fprintf(stderr, "Could not write part %d to %s\n", entry.part,
+            LEDGER_FILE);
+
+  return 1;
+}
+
+static int receive(Connection* connection,
+                   char* state,
+                   int* nb_done,
+                   FILE* ledger) {
+  // Read the available input of a worker, and handle its complete lines.
+  // Return whether the connection is still open.
+
+  char* line;
+  char* end;
+  ssize_t n;
+
+  if (connection->capacity - connection->length < 4096) {
+    connection->capacity = 2 * connection->capacity + 4096;
+    connection->input = realloc(connection->input, connection->capacity);
+  }
+  n = read(connection->fd, connection->input + connection->length,
+           connection->capacity - connection->length - 1);
+  if (n < 0 && errno == EINTR)
+    return 1;
+  if (n <= 0)
+    return 0;
+  connection->length += n;
+  connection->input[connection->length] = '\0';
+
+  line = connection->input;
+  while ((end = strchr(line, '\n'))) {
+    char next = end[1];
+
+    end[1] = '\0';
+    if (!handle_line(connection, line, state, nb_done, ledger))
+      return 0;
+    end[1] = next;
+    line = end + 1;
+  }
+  connection->length -= line - connection->input;
+  memmove(connection->input, line, connection->length);
+
+  return 1;
+}
+
+static void disconnect(Connection* connection, char* state) {
+  // Close the connection, and put its part back in the queue.
+
+  close(connection->fd);
+  connection->fd = -1;
+  if (connection->part >= 0 && state[connection->part] == BUSY) {
+    fprintf(stderr, "A worker stopped during part %d\n", connection->part);
+    state[connection->part] = TODO;
+  }
+  free(connection->input);
+}
+
+static int coordinate() {
+  // Hand out the MOD parts to the workers that connect to COORDINATOR, and
+  // add up the counts that they report. Each finished part is appended to
+  // the ledger, so a coordinator that is restarted with the same ledger only
+  // hands out the other parts. A worker gets the next part when it has
+  // finished the previous one, and the part of a worker that disconnects is
+  // handed out again. Return whether all parts were generated.
+
+  LedgerOptions options = {FACTOR,           MOD,
+                           SPLIT_LEVEL,      get_filter_lsp(),
+                           get_connectivity(), ALL};
+  static LedgerEntry entry;
+  char* state = calloc(MOD, 1);
+  int nb_done = 0, nb_skipped, nb_connections = 0, capacity = 0,
+      listener = -1;
+  Connection* connections = NULL;
+  FILE* ledger = NULL;
+
+  if (LEDGER_FILE) {
+    if (!(ledger = open_ledger(LEDGER_FILE, &options))) {
+      fprintf(stderr,
+              "Could not open %s, or it was made with different options.\n",
+              LEDGER_FILE);
+      free(state);
+      return 0;
+    }
+    while (!read_ledger_entry(ledger, FACTOR, &entry)) {
+      if (entry.part < MOD && state[entry.part] == TODO) {
+        state[entry.part] = DONE;
+        nb_done++;
+        add_entry(&entry);
+      }
+    }
+    if (nb_done)
+      fprintf(stderr, "%d of %d parts are in %s\n", nb_done, MOD,
+              LEDGER_FILE);
+  }
+  nb_skipped = nb_done;
+
+  if (nb_done < MOD && (listener = listen_socket(COORDINATOR)) < 0) {
+    fprintf(stderr, "Could not listen on %s\n", COORDINATOR);
+    nb_done = -1;
+  }
+
+  // A worker that disconnects while a part is sent to it is handled below
+  signal(SIGPIPE, SIG_IGN);
+
+  for (int next = 0; nb_done >= 0 && nb_done < MOD;) {
+    struct pollfd fds[nb_connections + 1];
+
+    if (atomic_exchange(&PROGRESS_REQUEST, 0))
+      report_parts(nb_done, nb_skipped);
+
+    // Give the first parts in the queue to the idle workers
+    for (int i = 0; i < nb_connections; i++) {
+      Connection* connection = &connections[i];
+      char command[32];
+
+      while (next < MOD && state[next] != TODO)
+        next++;
+      if (!connection->ready || connection->part >= 0 || next == MOD)
+        continue;
+      state[next] = BUSY;
+      connection->part = next;
+      snprintf(command, sizeof(command), "part %d\n", next);
+      write_all(connection->fd, command, strlen(command));
+    }
+
+    fds[0].fd = listener;
+    fds[0].events = POLLIN;
+    for (int i = 0; i < nb_connections; i++) {
+      fds[i + 1].fd = connections[i].fd;
+      fds[i + 1].events = POLLIN;
+    }
+    if (poll(fds, nb_connections + 1, progress_timeout()) < 0) {
+      if (errno == EINTR)
+        continue;
+      nb_done = -1;
+      break;
+    }
+
+    for (int i = 0; i < nb_connections; i++) {
+      int part = connections[i].part;
+
+      if (fds[i + 1].revents &&
+          !receive(&connections[i], state, &nb_done, ledger)) {
+        disconnect(&connections[i], state);
+        if (part >= 0 && part < next)
+          next = part;
+      }
+    }
+
+    // Forget the closed connections
+    int nb_open = 0;
+    for (int i = 0; i < nb_connections; i++) {
+      if (connections[i].fd >= 0)
+        connections[nb_open++] = connections[i];
+    }
+    nb_connections = nb_open;
+
+    if (fds[0].revents) {
+      int fd = accept_socket(listener);
+
+      if (fd >= 0) {
+        if (nb_connections == capacity) {
+          capacity = 2 * capacity + 16;
+          connections = realloc(connections, capacity * sizeof(Connection));
+        }
+        connections[nb_connections++] = (Connection){fd, -1, 0, NULL, 0, 0};
       }
     }
-  } else {
-    // Apply extensions
-    try_extension(dpd, nb_edge_orbits, extension1, reduction1, 1);
-    try_extension(dpd, nb_edge_orbits, extension2, reduction2, 2);
-    try_extension(dpd, nb_edge_orbits, extension3, reduction3, 3);
-    try_extension(dpd, nb_edge_orbits, extension4, reduction4, 4);
   }
+
+  // Let the workers exit
+  for (int i = 0; i < nb_connections; i++) {
+    write_all(connections[i].fd, "done\n", 5);
+    disconnect(&connections[i], state);
+  }
+  free(connections);
+  if (listener >= 0)
+    close_socket(listener, COORDINATOR);
+  if (ledger)
+    fclose(ledger);
+  free(state);
+
+  return nb_done == MOD;
 }
 
-void start_construction(DoublePreDeco* dpd) {
-  /* First base */
-  dpd->order = dpd->size = 0;
-  dpd->n1 = dpd->n2 = 0;
+static int serve_coordinator() {
+  // Generate the parts that the coordinator at CONNECT hands out, and send
+  // the ledger entry of each part back. The counts of the generated parts are
+  // added to the first generator. Return whether the coordinator finished.
 
-  int v0 = create_vertex(dpd);
-  int v1 = create_vertex(dpd);
-  int v2 = create_vertex(dpd);
-  Edge* edge0 = create_edge(dpd, v0, v1);
-  Edge* inverse0 = edge0->inverse;
-  Edge* edge1 = create_edge(dpd, v1, v2);
-  Edge* inverse1 = edge1->inverse;
+  static LedgerEntry entry;
+  char* line = NULL;
+  size_t capacity = 0;
+  int fd, part, finished = 0, nb_parts = 0;
+  FILE *in, *out;
 
-  set_next(edge0, edge0);
-  set_next(inverse0, edge1);
-  set_next(edge1, inverse0);
-  set_next(inverse1, inverse1);
+  if ((fd = connect_socket(CONNECT)) < 0) {
+    fprintf(stderr, "Could not connect to %s\n", CONNECT);
+    return 0;
+  }
+  in = fdopen(fd, "r");
+  out = fdopen(dup(fd), "w");
 
-  int nb_edge_orbits = canon(dpd, 0, edge0, CANONICAL_EDGES[dpd->order]);
-  CHECK(dpd);
-  grow(dpd, nb_edge_orbits);
+  // The coordinator may disconnect at any moment
+  signal(SIGPIPE, SIG_IGN);
 
-  if (FACTOR < 5)
-    return;
+  hello(line = malloc(128), 128);
+  fputs(line, out);
+  fflush(out);
+  while (getline(&line, &capacity, in) > 0) {
+    if (sscanf(line, "part %d", &part) != 1 || part < 0 || part >= MOD) {
+      finished = !strcmp(line, "done\n");
+      if (!finished)
+        fprintf(stderr, "The coordinator answered: %s", line);
+      break;
+    }
+    if (!generate_part(part, &entry))
+      break;
+    print_ledger_entry(out, FACTOR, &entry);
+    if (fflush(out))
+      break;
+    add_entry(&entry);
+    nb_parts++;
+  }
+  fprintf(stderr, "Generated %d parts\n", nb_parts);
 
-  /* Second base */
-  int v3 = create_vertex(dpd);
-  Edge* edge2 = create_edge(dpd, 0, v3);
-  Edge* inverse2 = edge2->inverse;
-  Edge* edge3 = create_edge(dpd, v3, v2);
-  Edge* inverse3 = edge3->inverse;
-
-  set_next(edge2, edge0);
-  set_next(edge0, edge2);
-  set_next(inverse3, inverse1);
-  set_next(inverse1, inverse3);
-  set_next(edge3, inverse2);
-  set_next(inverse2, edge3);
-
-  nb_edge_orbits = canon(dpd, 0, edge0, CANONICAL_EDGES[dpd->order]);
-  CHECK(dpd);
-  grow(dpd, nb_edge_orbits);
-
-  if (FACTOR < 11)
+  free(line);
+  fclose(in);
+  fclose(out);
+
+  return finished;
+}
+
+#ifdef SMALLFACTOR
+static void dispatch(char* argv[]) {
+  // Run the specialized build for the factor, which is installed next to this
+  // build with the suffix -small or -large. Return if there is none.
+
+  const char* suffix = FACTOR <= SMALLFACTOR ? "-small"
+                       : FACTOR > MAXFACTOR  ? "-large"
+                                             : NULL;
+  char path[strlen(argv[0]) + 7];
+
+  if (!suffix)
     return;
+  snprintf(path, sizeof(path), "%s%s", argv[0], suffix);
+  argv[0] = path;
+  execvp(path, argv);
+}
+#endif
 
-  /* Third base */
-  int v4 = create_vertex(dpd);
-  int v5 = create_vertex(dpd);
-  int v6 = create_vertex(dpd);
-  int v7 = create_vertex(dpd);
-
-  Edge* edge4 = create_edge(dpd, v0, v4);
-  Edge* inverse4 = edge4->inverse;
-  Edge* edge5 = create_edge(dpd, v1, v5);
-  Edge* inverse5 = edge5->inverse;
-  Edge* edge6 = create_edge(dpd, v2, v6);
-  Edge* inverse6 = edge6->inverse;
-  Edge* edge7 = create_edge(dpd, v3, v7);
-  Edge* inverse7 = edge7->inverse;
-  Edge* edge8 = create_edge(dpd, v4, v5);
-  Edge* inverse8 = edge8->inverse;
-  Edge* edge9 = create_edge(dpd, v5, v6);
-  Edge* inverse9 = edge9->inverse;
-  Edge* edge10 = create_edge(dpd, v4, v7);
-  Edge* inverse10 = edge10->inverse;
-  Edge* edge11 = create_edge(dpd, v7, v6);
-  Edge* inverse11 = edge11->inverse;
-
-  set_next(edge4, edge0);
-  set_next(edge2, edge4);
-  set_next(edge5, edge1);
-  set_next(inverse0, edge5);
-  set_next(edge6, inverse3);
-  set_next(inverse1, edge6);
-  set_next(edge7, inverse2);
-  set_next(edge3, edge7);
-
-  set_next(edge8, inverse4);
-  set_next(edge10, edge8);
-  set_next(edge9, inverse5);
-  set_next(inverse8, edge9);
-  set_next(inverse4, edge10);
-  set_next(inverse5, inverse8);
-  set_next(inverse11, inverse6);
-  set_next(inverse6, inverse9);
-  set_next(inverse9, inverse11);
-  set_next(inverse10, inverse7);
-  set_next(edge11, inverse10);
-  set_next(inverse7, edge11);
-
-  nb_edge_orbits = canon(dpd, 0, edge0, CANONICAL_EDGES[dpd->order]);
-  CHECK(dpd);
-  grow(dpd, nb_edge_orbits);
+static int parse_roots(char* list) {
+  // Add the comma separated IDs of --manifest to the roots. Return whether
+  // they are valid and there is at least one. The list is split in a copy,
+  // since dispatch passes argv on to the specialized builds.
+  int nb_roots = NB_ROOTS;
+
+  list = strdup(list);
+  for (char* id = strtok(list, ","); id; id = strtok(NULL, ",")) {
+    Root* root;
+    char* p = id;
+
+    ROOTS = realloc(ROOTS, (NB_ROOTS + 1) * sizeof(Root));
+    root = &ROOTS[NB_ROOTS++];
+    root->id = id;
+    root->found = 0;
+    root->base = strtol(p, &p, 10);
+    if (p == id || root->base < 1 || root->base > 3)
+      return 0;
+    for (root->depth = base_depth(root->base); *p == '/'; root->depth++) {
+      char* start = p + 1;
+
+      if (root->depth + 1 >= MAXORDER)
+        return 0;
+      root->ext[root->depth] = strtol(start, &p, 10);
+      if (p == start || *p != '.' || root->ext[root->depth] < 1 ||
+          root->ext[root->depth] > 4)
+        return 0;
+      start = p + 1;
+      root->orbit[root->depth] = strtol(start, &p, 10);
+      if (p == start || root->orbit[root->depth] < 0)
+        return 0;
+    }
+    if (*p)
+      return 0;
+  }
+
+  return NB_ROOTS > nb_roots;
 }
 
 static void write_help(FILE* file) {
-  fprintf(file, "Usage: decogen [-d] [-a] [-c 1|2|3] [-o OUTFILE] FACTOR\n\n");
+  fprintf(file,
+          "Usage: decogen [-d] [-a] [-c 1|2|3] [-o OUTFILE] [-j N] "
+          "[-m MOD -r RES] [-s LEVEL] FACTOR\n\n");
   fprintf(file, " -d,--decocode      write decocode to stdout or outfile\n");
   fprintf(file,
-          " -a,--all           generate decorations with smaller factors\n");
+          " -a,--all           also generate all smaller factors in the same "
+          "run\n");
   fprintf(file,
           " -c,--connectivity  generate decorations with connectivity 1/2/3\n");
   fprintf(file, " -o,--output        write to OUTFILE instead of stdout\n");
+  fprintf(file,
+          "                    (with -a, %%d in OUTFILE gives a file per "
+          "factor)\n");
+  fprintf(file,
+          " -j,--threads N     generate with N threads that share the work\n");
+  fprintf(file,
+          " --workers N        generate the parts of -m MOD (default 8 * N) "
+          "with N\n"
+          "                    processes, each part to OUTFILE.RES with -o\n");
+  fprintf(file,
+          " --coordinator ADDRESS\n"
+          "                    hand out the parts of -m MOD to the workers "
+          "that connect to\n"
+          "                    ADDRESS, which is HOST:PORT for TCP or the "
+          "path of a socket\n");
+  fprintf(file,
+          " --ledger FILE      append the counts of each finished part to "
+          "FILE, and skip\n"
+          "                    the parts that are already in it\n");
+  fprintf(file,
+          " --connect ADDRESS  generate the parts that the coordinator at "
+          "ADDRESS hands\n"
+          "                    out, each part to OUTFILE.RES with -o\n");
+  fprintf(file,
+          " --checkpoint FILE  save the progress to FILE periodically and "
+          "on SIGTERM\n");
+  fprintf(file,
+          " --interval SECONDS save a checkpoint every SECONDS seconds "
+          "(default 3600)\n");
+  fprintf(file,
+          " --resume FILE      continue from the checkpoint in FILE, with "
+          "the same options\n");
+  fprintf(file,
+          " -m,--mod MOD       split the generation in MOD parts "
+          "(default 1)\n");
+  fprintf(file,
+          " -r,--res RES       only generate part RES, with 0 <= RES < MOD\n");
+  fprintf(file,
+          " -s,--split LEVEL   split the generation tree at depth LEVEL "
+          "(default 3)\n");
+  fprintf(file,
+          " --estimate SAMPLES estimate the counts and the run time from "
+          "SAMPLES random\n"
+          "                    paths instead of generating\n");
+  fprintf(file,
+          " --choose-split K   print the shallowest split level with at "
+          "least K balanced\n"
+          "                    units per part for -m MOD, instead of "
+          "generating\n");
+  fprintf(file,
+          " --seed N           seed the random paths of --estimate and "
+          "--choose-split\n"
+          "                    (default 0 for --choose-split, the clock "
+          "for --estimate)\n");
+  fprintf(file,
+          " --manifest         print the IDs of the units of the split "
+          "level, in the\n"
+          "                    order of -m, instead of generating\n");
+  fprintf(file,
+          " --root ID[,ID...]  only generate the units with the given IDs "
+          "of --manifest\n");
+  fprintf(file,
+          " --stats FILE       write counters and times of each order of "
+          "the construction\n"
+          "                    to FILE as JSON\n");
+  fprintf(file,
+          " --progress SECONDS report the progress with an ETA every SECONDS "
+          "seconds\n"
+          "                    (the progress is also reported on SIGUSR1)\n");
   fprintf(file,
           " FACTOR             generate decorations with factor FACTOR (or "
           "smaller with -a)\n");
@@ -195,8 +2097,6 @@ static void write_help(FILE* file) {
 int main(int argc, char* argv[]) {
   int c, option_index;
 
-  OUTFILE = stdout;
-
   static struct option long_options[] = {
       {"decocode", no_argument, 0, 'd'},
       {"all", no_argument, 0, 'a'},
@@ -208,10 +2108,27 @@ int main(int argc, char* argv[]) {
       {"split", required_argument, 0, 's'},
       {"predeco", no_argument, 0, 'p'},
       {"lsp", no_argument, 0, 'l'},
+      {"threads", required_argument, 0, 'j'},
+      {"checkpoint", required_argument, 0, 'C'},
+      {"interval", required_argument, 0, 'I'},
+      {"resume", required_argument, 0, 'R'},
+      {"estimate", required_argument, 0, 'E'},
+      {"choose-split", required_argument, 0, 'S'},
+      {"seed", required_argument, 0, 'D'},
+      {"workers", required_argument, 0, 'W'},
+      {"coordinator", required_argument, 0, 'O'},
+      {"connect", required_argument, 0, 'N'},
+      {"ledger", required_argument, 0, 'L'},
+      {"manifest", no_argument, 0, 'M'},
+      {"root", required_argument, 0, 'T'},
+      {"stats", required_argument, 0, 'Z'},
+      {"progress", required_argument, 0, 'G'},
+      {0, 0, 0, 0},
   };
 
   while (1) {
-    c = getopt_long(argc, argv, "dac:o:hm:r:s:pl", long_options, &option_index);
+    c = getopt_long(argc, argv, "dac:o:hm:r:s:plj:", long_options,
+                    &option_index);
     if (c == -1)
       break;
     switch (c) {
@@ -222,14 +2139,14 @@ int main(int argc, char* argv[]) {
         ALL = 1;
         break;
       case 'c':
-        CONNECTIVITY = strtol(optarg, NULL, 10);
-        if (CONNECTIVITY < 1 || CONNECTIVITY > 3) {
+        set_connectivity(strtol(optarg, NULL, 10));
+        if (get_connectivity() < 1 || get_connectivity() > 3) {
           fprintf(stderr, "Connectivity has to be 1, 2 or 3.\n");
           return 1;
         }
         break;
       case 'o':
-        OUTFILE = fopen(optarg, "w");
+        OUTFILENAME = optarg;
         break;
       case 'h':
         write_help(stdout);
@@ -249,17 +2166,207 @@ int main(int argc, char* argv[]) {
       case 'l':
         filter_lsp(1);
         break;
+      case 'j':
+        THREADS = strtol(optarg, NULL, 10);
+        if (THREADS < 1) {
+          fprintf(stderr, "The number of threads has to be positive.\n");
+          return 1;
+        }
+        break;
+      case 'C':
+        CHECKPOINT_FILE = optarg;
+        break;
+      case 'I':
+        CHECKPOINT_INTERVAL = strtol(optarg, NULL, 10);
+        if (CHECKPOINT_INTERVAL < 1) {
+          fprintf(stderr, "The checkpoint interval has to be positive.\n");
+          return 1;
+        }
+        break;
+      case 'R':
+        if (read_checkpoint(optarg, &RESUME)) {
+          fprintf(stderr, "Could not read checkpoint %s\n", optarg);
+          return 1;
+        }
+        RESUMING = 1;
+        if (!CHECKPOINT_FILE)
+          CHECKPOINT_FILE = optarg;
+        break;
+      case 'E':
+        ESTIMATE = strtol(optarg, NULL, 10);
+        if (ESTIMATE < 1) {
+          fprintf(stderr, "The number of samples has to be positive.\n");
+          return 1;
+        }
+        break;
+      case 'S':
+        CHOOSE_SPLIT = strtol(optarg, NULL, 10);
+        if (CHOOSE_SPLIT < 1) {
+          fprintf(stderr, "The number of units per part has to be positive.\n");
+          return 1;
+        }
+        break;
+      case 'D':
+        SEED = strtol(optarg, NULL, 10);
+        if (SEED < 0) {
+          fprintf(stderr, "The seed can not be negative.\n");
+          return 1;
+        }
+        break;
+      case 'W':
+        WORKERS = strtol(optarg, NULL, 10);
+        if (WORKERS < 1) {
+          fprintf(stderr, "The number of workers has to be positive.\n");
+          return 1;
+        }
+        break;
+      case 'O':
+        COORDINATOR = optarg;
+        break;
+      case 'N':
+        CONNECT = optarg;
+        break;
+      case 'L':
+        LEDGER_FILE = optarg;
+        break;
+      case 'M':
+        MANIFEST = 1;
+        break;
+      case 'G':
+        PROGRESS_INTERVAL = strtol(optarg, NULL, 10);
+        if (PROGRESS_INTERVAL < 1) {
+          fprintf(stderr, "The progress interval has to be positive.\n");
+          return 1;
+        }
+        break;
+      case 'Z':
+        STATS_FILE = optarg;
+        break;
+      case 'T':
+        if (!parse_roots(optarg)) {
+          fprintf(stderr, "\"%s\" is no valid list of IDs.\n", optarg);
+          return 1;
+        }
+        break;
       default:
         write_help(stderr);
         return 1;
     }
   }
 
+  if (MOD < 1 || RES < 0 || RES >= MOD) {
+    fprintf(stderr, "Residue has to be between 0 and modulo.\n");
+    return 1;
+  }
+
+  if (THREADS > 1 && MOD > 1) {
+    fprintf(stderr, "-j and -m are mutually exclusive\n");
+    return 1;
+  }
+
+  if (THREADS > 1 && CHECKPOINT_FILE) {
+    fprintf(stderr, "-j can not be combined with checkpoints\n");
+    return 1;
+  }
+
+  if (CHECKPOINT_FILE && (OUTPUT || DPD_OUTPUT) && !OUTFILENAME) {
+    fprintf(stderr, "Checkpoints can only be combined with output to files "
+                    "with -o\n");
+    return 1;
+  }
+
   if (OUTPUT && DPD_OUTPUT) {
     fprintf(stderr, "-d and -p are mutually exclusive\n");
     return 1;
   }
 
+  if (ESTIMATE && (OUTPUT || DPD_OUTPUT || THREADS > 1 || MOD > 1 ||
+                   CHECKPOINT_FILE)) {
+    fprintf(stderr,
+            "--estimate can not be combined with output, threads, parts or "
+            "checkpoints\n");
+    return 1;
+  }
+
+  if (CHOOSE_SPLIT &&
+      (ESTIMATE || OUTPUT || DPD_OUTPUT || THREADS > 1 || CHECKPOINT_FILE)) {
+    fprintf(stderr,
+            "--choose-split can not be combined with --estimate, output, "
+            "threads or checkpoints\n");
+    return 1;
+  }
+
+  if (WORKERS && (RES || THREADS > 1 || CHECKPOINT_FILE || ESTIMATE ||
+                  CHOOSE_SPLIT)) {
+    fprintf(stderr,
+            "--workers can not be combined with -r, threads, checkpoints, "
+            "--estimate or --choose-split\n");
+    return 1;
+  }
+
+  if (COORDINATOR &&
+      (CONNECT || WORKERS || OUTPUT || DPD_OUTPUT || OUTFILENAME || RES ||
+       THREADS > 1 || CHECKPOINT_FILE || ESTIMATE || CHOOSE_SPLIT)) {
+    fprintf(stderr,
+            "--coordinator can not be combined with --connect, --workers, "
+            "output, -r,\nthreads, checkpoints, --estimate or "
+            "--choose-split\n");
+    return 1;
+  }
+
+  if (CONNECT && (WORKERS || RES || THREADS > 1 || CHECKPOINT_FILE ||
+                  ESTIMATE || CHOOSE_SPLIT)) {
+    fprintf(stderr,
+            "--connect can not be combined with --workers, -r, threads, "
+            "checkpoints,\n--estimate or --choose-split\n");
+    return 1;
+  }
+
+  if (CONNECT && (OUTPUT || DPD_OUTPUT) && !OUTFILENAME) {
+    fprintf(stderr, "--connect can only write output to files with -o\n");
+    return 1;
+  }
+
+  if (MANIFEST && (NB_ROOTS || OUTPUT || DPD_OUTPUT || MOD > 1 ||
+                   THREADS > 1 || CHECKPOINT_FILE || ESTIMATE ||
+                   CHOOSE_SPLIT || WORKERS || COORDINATOR || CONNECT)) {
+    fprintf(stderr,
+            "--manifest can only be combined with -a, -c, -l and -s\n");
+    return 1;
+  }
+
+  if (NB_ROOTS && (MOD > 1 || CHECKPOINT_FILE || ESTIMATE || CHOOSE_SPLIT ||
+                   WORKERS || COORDINATOR || CONNECT)) {
+    fprintf(stderr,
+            "--root can not be combined with -m, checkpoints, --estimate, "
+            "--choose-split,\n--workers, --coordinator or --connect\n");
+    return 1;
+  }
+
+  if (STATS_FILE && (ESTIMATE || CHOOSE_SPLIT || MANIFEST || WORKERS ||
+                     COORDINATOR || CONNECT)) {
+    fprintf(stderr,
+            "--stats can not be combined with --estimate, --choose-split, "
+            "--manifest,\n--workers, --coordinator or --connect\n");
+    return 1;
+  }
+
+  if (PROGRESS_INTERVAL && (ESTIMATE || CHOOSE_SPLIT || MANIFEST)) {
+    fprintf(stderr,
+            "--progress can not be combined with --estimate, --choose-split "
+            "or --manifest\n");
+    return 1;
+  }
+
+  if (LEDGER_FILE && !COORDINATOR) {
+    fprintf(stderr, "--ledger needs --coordinator\n");
+    return 1;
+  }
+
+  // Give each worker several parts, so that they finish at the same time
+  if (WORKERS && MOD == 1)
+    MOD = 8 * WORKERS;
+
   if (optind == argc) {
     write_help(stderr);
     return 1;
@@ -269,21 +2376,144 @@ int main(int argc, char* argv[]) {
   if (FACTOR < 1) {
     fprintf(stderr, "\"%s\" is no positive numeric value.\n", argv[optind]);
     return 1;
-  } else if (FACTOR > MAXFACTOR) {
-    fprintf(stderr, "inflation rates higher than %d are not supported.\n",
-            MAXSIZE / 2);
+  }
+#ifdef SMALLFACTOR
+  dispatch(argv);
+#endif
+  if (FACTOR > MAXFACTOR) {
+    fprintf(stderr,
+            "inflation rates higher than %d need a build with a larger "
+            "MAXFACTOR.\n",
+            MAXFACTOR);
     return 1;
   }
+  MIN_FACTOR = ALL ? 1 : FACTOR;
 
-  // if (OUTPUT) write_deco_header(OUTFILE);
-  if (DPD_OUTPUT)
-    write_planar_header(OUTFILE);
+  if (RESUMING &&
+      (RESUME.factor != FACTOR || RESUME.mod != MOD || RESUME.res != RES ||
+       RESUME.split_level != SPLIT_LEVEL || RESUME.lsp != get_filter_lsp() ||
+       RESUME.connectivity != get_connectivity() || RESUME.all != ALL ||
+       RESUME.base < 1 || RESUME.base > 3)) {
+    fprintf(stderr, "The checkpoint was made with different options.\n");
+    return 1;
+  }
 
-  DoublePreDeco dpd;
-  start_construction(&dpd);
+  for (int f = MIN_FACTOR; f <= FACTOR; f++) {
+    if (shares_output(f)) {
+      // All factors share the same output
+      OUTFILES[f] = OUTFILES[f - 1];
+      continue;
+    }
+    if (!OUTFILENAME)
+      OUTFILES[f] = stdout;
+    else if (WORKERS || CONNECT)
+      continue;  // Each part gets its own output file
+    else if (!(OUTFILES[f] = open_output(f)))
+      return 1;
+    if (CHECKPOINT_FILE && (OUTPUT || DPD_OUTPUT) && ftell(OUTFILES[f]) < 0) {
+      // A resumed run could not drop the output after the checkpoint
+      fprintf(stderr, "Checkpoints need a seekable output file\n");
+      return 1;
+    }
+    if (!RESUMING)
+      write_header(OUTFILES[f]);
+  }
+
+  if (CHECKPOINT_FILE) {
+    signal(SIGTERM, request_checkpoint);
+    signal(SIGALRM, request_checkpoint);
+    alarm(CHECKPOINT_INTERVAL);
+  }
+
+  GENERATORS = malloc(THREADS * sizeof(Generator*));
+  for (int i = 0; i < THREADS; i++) {
+    GENERATORS[i] = create_generator();
+    GENERATORS[i]->thread = i;
+    if (OUTPUT)
+      create_deco_buffers(GENERATORS[i], OUTFILES, MIN_FACTOR, FACTOR);
+    if (STATS_FILE)
+      GENERATORS[i]->stats = calloc(MAXORDER + 1, sizeof(Stats));
+  }
+
+  if (RESUMING) {
+    GENERATORS[0]->nb_split_nodes = RESUME.nb_split_nodes;
+    for (int f = 1; f <= FACTOR; f++) {
+      GENERATORS[0]->count[f] = RESUME.count[f];
+      GENERATORS[0]->precount[f] = RESUME.precount[f];
+    }
+  }
+
+  // --estimate and --choose-split do not report, but SIGUSR1 must not kill
+  // them either
+  start_progress();
+
+  if (ESTIMATE || CHOOSE_SPLIT || MANIFEST) {
+    if (ESTIMATE) {
+      estimate(GENERATORS[0]);
+    } else if (CHOOSE_SPLIT) {
+      choose_split(GENERATORS[0]);
+    } else {
+      start_construction(GENERATORS[0]);
+      fprintf(stderr, "%llu units\n", GENERATORS[0]->nb_split_nodes);
+    }
+    free_generator(GENERATORS[0]);
+    free(GENERATORS);
+    return 0;
+  } else if (WORKERS) {
+    if (!run_workers())
+      return 1;
+  } else if (COORDINATOR) {
+    if (!coordinate())
+      return 1;
+  } else if (CONNECT) {
+    if (!serve_coordinator())
+      return 1;
+  } else {
+    if (THREADS == 1)
+      start_construction(GENERATORS[0]);
+    else
+      run_threads();
+  }
+
+  for (int i = 0; i < NB_ROOTS; i++) {
+    if (!ROOTS[i].found)
+      fprintf(stderr, "%s is not a unit of this split level\n", ROOTS[i].id);
+  }
 
-  fprintf(stderr, "%lld decorations (%lld predecorations)\n", 2 * get_count(),
-          get_precount());
+  for (int f = MIN_FACTOR; f <= FACTOR; f++) {
+    unsigned long long count = 0, precount = 0;
+    for (int i = 0; i < THREADS; i++) {
+      count += get_count(GENERATORS[i], f);
+      precount += get_precount(GENERATORS[i], f);
+    }
+    if (ALL)
+      fprintf(stderr, "%d: ", f);
+    fprintf(stderr, "%llu decorations (%llu predecorations)\n", 2 * count,
+            precount);
+  }
+
+  if (STATS_FILE) {
+    for (int i = 1; i < THREADS; i++)
+      add_stats(GENERATORS[0]->stats, GENERATORS[i]->stats, MAXORDER + 1);
+    if (write_stats(STATS_FILE, FACTOR, GENERATORS[0]->stats))
+      fprintf(stderr, "Could not write %s\n", STATS_FILE);
+  }
+
+  for (int i = 0; i < THREADS; i++) {
+    free_deco_buffers(GENERATORS[i]);
+    free(GENERATORS[i]->stats);
+    free_generator(GENERATORS[i]);
+  }
+  free(GENERATORS);
+  if (PROGRESS_REPLAY)
+    free_generator(PROGRESS_REPLAY);
+  free(ROOTS);
+
+  if (CHECKPOINT_FILE) {
+    // The construction is complete, so the checkpoint must not be resumed.
+    alarm(0);
+    unlink(CHECKPOINT_FILE);
+  }
 
   return 0;
 }
@@ -15,105 +15,216 @@
 
 #include "extensions.h"
 
-static int _extension1(DoublePreDeco* dpd, Edge* edgeA) {
-  Edge* edgeB = edgeA->inverse->prev->inverse;
-
-  int vertex = create_vertex(dpd);
-  Edge* edge0 = create_edge(dpd, edgeA->start, vertex);
-  Edge* inverse0 = edge0->inverse;
-  Edge* edge1 = create_edge(dpd, edgeB->start, vertex);
-  Edge* inverse1 = edge1->inverse;
-
-  set_next(edge0, edgeA->next);
-  set_next(edgeA, edge0);
-  set_next(edgeB->prev, edge1);
-  set_next(edge1, edgeB);
-  set_next(inverse0, inverse1);
-  set_next(inverse1, inverse0);
+static int _extension1(Generator* gen, DoublePreDeco* dpd, Edge edgeA) {
+  Edge edgeB = inverse(gen->prev[inverse(edgeA)]);
+
+  int vertex = create_vertex(gen, dpd);
+  Edge edge0 = create_edge(gen, dpd, gen->start[edgeA], vertex);
+  Edge inverse0 = inverse(edge0);
+  Edge edge1 = create_edge(gen, dpd, gen->start[edgeB], vertex);
+  Edge inverse1 = inverse(edge1);
+
+  set_next(gen, edge0, gen->next[edgeA]);
+  set_next(gen, edgeA, edge0);
+  set_next(gen, gen->prev[edgeB], edge1);
+  set_next(gen, edge1, edgeB);
+  set_next(gen, inverse0, inverse1);
+  set_next(gen, inverse1, inverse0);
 
   return 1;
 }
 
-int extension1(DoublePreDeco* dpd, Edge* edgeA) {
-  if (degree(edgeA->end) > 1 && degree(edgeA->start) < 3)
+static int applies1(Generator* gen, Edge edgeA) {
+  return degree(gen, gen->end[edgeA]) <= 1 ||
+         degree(gen, gen->start[edgeA]) >= 3;
+}
+
+int extension1(Generator* gen, DoublePreDeco* dpd, Edge edgeA) {
+  if (!applies1(gen, edgeA))
     return 0;
 
-  return _extension1(dpd, edgeA);
+  return _extension1(gen, dpd, edgeA);
+}
+
+void reduction1(Generator* gen, DoublePreDeco* dpd) {
+  remove_extension(gen, dpd);
 }
 
-void reduction1(DoublePreDeco* dpd, Edge* edgeA) {
-  remove_extension(dpd);
+static int applies2(Generator* gen, Edge edgeA) {
+  return degree(gen, gen->start[edgeA]) == 2 &&
+         degree(gen, gen->end[gen->prev[inverse(edgeA)]]) == 2;
 }
 
-int extension2(DoublePreDeco* dpd, Edge* edgeA) {
-  if (degree(edgeA->start) != 2 || degree(edgeA->inverse->prev->end) != 2)
+int extension2(Generator* gen, DoublePreDeco* dpd, Edge edgeA) {
+  if (!applies2(gen, edgeA))
     return 0;
 
-  return _extension1(dpd, edgeA);
+  return _extension1(gen, dpd, edgeA);
 }
 
-void reduction2(DoublePreDeco* dpd, Edge* edgeA) {
-  remove_extension(dpd);
+void reduction2(Generator* gen, DoublePreDeco* dpd) {
+  remove_extension(gen, dpd);
 }
 
-int extension3(DoublePreDeco* dpd, Edge* edge) {
-  Edge* inverse = edge->inverse;
+int extension3(Generator* gen, DoublePreDeco* dpd, Edge edge) {
+  Edge back = inverse(edge);
 
-  int vertex = create_vertex(dpd);
-  Edge* edge0 = create_edge(dpd, edge->start, edge->end);
-  Edge* inverse0 = edge0->inverse;
-  Edge* edge1 = create_edge(dpd, edge->start, vertex);
-  Edge* inverse1 = edge1->inverse;
+  int vertex = create_vertex(gen, dpd);
+  Edge edge0 = create_edge(gen, dpd, gen->start[edge], gen->end[edge]);
+  Edge inverse0 = inverse(edge0);
+  Edge edge1 = create_edge(gen, dpd, gen->start[edge], vertex);
+  Edge inverse1 = inverse(edge1);
 
-  set_next(edge0, edge->next);
-  set_next(edge, edge1);
-  set_next(edge1, edge0);
-  set_next(inverse1, inverse1);
-  set_next(inverse->prev, inverse0);
-  set_next(inverse0, inverse);
+  set_next(gen, edge0, gen->next[edge]);
+  set_next(gen, edge, edge1);
+  set_next(gen, edge1, edge0);
+  set_next(gen, inverse1, inverse1);
+  set_next(gen, gen->prev[back], inverse0);
+  set_next(gen, inverse0, back);
 
   return 1;
 }
 
-void reduction3(DoublePreDeco* dpd, Edge* edge) {
-  remove_extension(dpd);
+void reduction3(Generator* gen, DoublePreDeco* dpd) {
+  remove_extension(gen, dpd);
 }
 
-int extension4(DoublePreDeco* dpd, Edge* edgeA) {
-  if (degree(edgeA->start) < 3 || degree(edgeA->end) < 4)
+static int applies4(Generator* gen, Edge edgeA) {
+  if (degree(gen, gen->start[edgeA]) < 3 || degree(gen, gen->end[edgeA]) < 4)
     return 0;
 
-  Edge* inverseA = edgeA->inverse;
-  Edge* edgeC = inverseA->prev;
-  Edge* inverseB = edgeC->prev;
-  Edge* edgeB = inverseB->inverse;
+  int startB = gen->end[gen->prev[gen->prev[inverse(edgeA)]]];
 
-  if (edgeA->start == edgeB->start || degree(edgeB->start) < 2)
+  return gen->start[edgeA] != startB && degree(gen, startB) >= 2;
+}
+
+int extension4(Generator* gen, DoublePreDeco* dpd, Edge edgeA) {
+  if (!applies4(gen, edgeA))
     return 0;
 
-  int vertex = create_vertex(dpd);
-  Edge* edge0 = create_edge(dpd, edgeA->start, vertex);
-  Edge* inverse0 = edge0->inverse;
-  Edge* edge1 = create_edge(dpd, edgeB->start, vertex);
-  Edge* inverse1 = edge1->inverse;
+  Edge inverseA = inverse(edgeA);
+  Edge edgeC = gen->prev[inverseA];
+  Edge inverseB = gen->prev[edgeC];
+  Edge edgeB = inverse(inverseB);
 
-  detach(dpd, edgeC);
+  int vertex = create_vertex(gen, dpd);
+  Edge edge0 = create_edge(gen, dpd, gen->start[edgeA], vertex);
+  Edge inverse0 = inverse(edge0);
+  Edge edge1 = create_edge(gen, dpd, gen->start[edgeB], vertex);
+  Edge inverse1 = inverse(edge1);
 
-  set_next(edge0, edgeA->next);
-  set_next(edgeA, edge0);
-  set_next(edgeB->prev, edge1);
-  set_next(edge1, edgeB);
-  set_next(inverse0, inverse1);
-  set_next(inverse1, inverse0);
+  detach(gen, dpd, edgeC);
 
-  attach(dpd, inverse1, edgeC);
+  set_next(gen, edge0, gen->next[edgeA]);
+  set_next(gen, edgeA, edge0);
+  set_next(gen, gen->prev[edgeB], edge1);
+  set_next(gen, edge1, edgeB);
+  set_next(gen, inverse0, inverse1);
+  set_next(gen, inverse1, inverse0);
+
+  attach(gen, dpd, inverse1, edgeC);
 
   return 1;
 }
 
-void reduction4(DoublePreDeco* dpd, Edge* edgeA) {
-  Edge* edgeC = edgeA->next->inverse->prev;
+void reduction4(Generator* gen, DoublePreDeco* dpd, Edge edgeA) {
+  Edge edgeC = gen->prev[inverse(gen->next[edgeA])];
+
+  remove_extension(gen, dpd);
+  restore_edge(gen, gen->prev[inverse(edgeA)], edgeC);
+}
+
+int apply_extension(Generator* gen, DoublePreDeco* dpd, int ext, Edge edge) {
+  switch (ext) {
+    case 1:
+      return extension1(gen, dpd, edge);
+    case 2:
+      return extension2(gen, dpd, edge);
+    case 3:
+      return extension3(gen, dpd, edge);
+    default:
+      return extension4(gen, dpd, edge);
+  }
+}
+
+static void change_degree(Generator* gen,
+                          DoublePreDeco* dpd,
+                          int vertex,
+                          int change) {
+  int d = degree(gen, vertex);
+
+  dpd->n1 += (d + change == 1) - (d == 1);
+  dpd->n2 += (d + change == 2) - (d == 2);
+}
+
+int predict_extension(Generator* gen,
+                      DoublePreDeco* dpd,
+                      int ext,
+                      Edge edgeA,
+                      DoublePreDeco* next) {
+  // Return whether the extension applies and, if so, set the order and the
+  // numbers of vertices of degree 1 and 2 of next to those after it, without
+  // applying it. This is enough to prune the child. The first edges of the
+  // vertices are left as applying and reducing the extension leaves them,
+  // since the output depends on them.
+
+  int startA = gen->start[edgeA];
+  Edge edgeB, edgeC;
+
+  next->order = dpd->order + 1;
+  next->n1 = dpd->n1;
+  next->n2 = dpd->n2;
+  switch (ext) {
+    case 1:
+    case 2:
+      if (ext == 1 ? !applies1(gen, edgeA) : !applies2(gen, edgeA))
+        return 0;
+      edgeB = inverse(gen->prev[inverse(edgeA)]);
+      if (startA == gen->start[edgeB]) {
+        change_degree(gen, next, startA, 2);
+      } else {
+        change_degree(gen, next, startA, 1);
+        change_degree(gen, next, gen->start[edgeB], 1);
+      }
+      next->n2++;
+      gen->firstedge[startA] = edgeA;
+      gen->firstedge[gen->start[edgeB]] = gen->prev[edgeB];
+      return 1;
+    case 3:
+      change_degree(gen, next, startA, 2);
+      change_degree(gen, next, gen->end[edgeA], 1);
+      next->n1++;
+      gen->firstedge[startA] = edgeA;
+      gen->firstedge[gen->end[edgeA]] = gen->prev[inverse(edgeA)];
+      return 1;
+    default:
+      if (!applies4(gen, edgeA))
+        return 0;
+      edgeC = gen->prev[inverse(edgeA)];
+      edgeB = inverse(gen->prev[edgeC]);
+      change_degree(gen, next, startA, 1);
+      change_degree(gen, next, gen->start[edgeB], 1);
+      change_degree(gen, next, gen->start[edgeC], -1);
+      gen->firstedge[startA] = edgeA;
+      gen->firstedge[gen->start[edgeB]] = gen->prev[edgeB];
+      if (gen->firstedge[gen->start[edgeC]] == edgeC)
+        gen->firstedge[gen->start[edgeC]] = inverse(edgeB);
+      return 1;
+  }
+}
 
-  remove_extension(dpd);
-  attach(dpd, edgeA->inverse->prev, edgeC);
+void apply_reduction(Generator* gen, DoublePreDeco* dpd, int ext, Edge edge) {
+  switch (ext) {
+    case 1:
+      reduction1(gen, dpd);
+      break;
+    case 2:
+      reduction2(gen, dpd);
+      break;
+    case 3:
+      reduction3(gen, dpd);
+      break;
+    default:
+      reduction4(gen, dpd, edge);
+  }
 }
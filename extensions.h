@@ -18,14 +18,22 @@
 
 #include "util.h"
 
-int extension1(DoublePreDeco* dpd, Edge* edge);
-int extension2(DoublePreDeco* dpd, Edge* edge);
-int extension3(DoublePreDeco* dpd, Edge* edge);
-int extension4(DoublePreDeco* dpd, Edge* edge);
-
-void reduction1(DoublePreDeco* dpd, Edge* edge);
-void reduction2(DoublePreDeco* dpd, Edge* edge);
-void reduction3(DoublePreDeco* dpd, Edge* edge);
-void reduction4(DoublePreDeco* dpd, Edge* edge);
+int extension1(Generator* gen, DoublePreDeco* dpd, Edge edge);
+int extension2(Generator* gen, DoublePreDeco* dpd, Edge edge);
+int extension3(Generator* gen, DoublePreDeco* dpd, Edge edge);
+int extension4(Generator* gen, DoublePreDeco* dpd, Edge edge);
+
+void reduction1(Generator* gen, DoublePreDeco* dpd);
+void reduction2(Generator* gen, DoublePreDeco* dpd);
+void reduction3(Generator* gen, DoublePreDeco* dpd);
+void reduction4(Generator* gen, DoublePreDeco* dpd, Edge edge);
+
+int predict_extension(Generator* gen,
+                      DoublePreDeco* dpd,
+                      int ext,
+                      Edge edge,
+                      DoublePreDeco* next);
+int apply_extension(Generator* gen, DoublePreDeco* dpd, int ext, Edge edge);
+void apply_reduction(Generator* gen, DoublePreDeco* dpd, int ext, Edge edge);
 
 #endif
@@ -0,0 +1,162 @@
+// Copyright (C) 2022 Pieter Goetschalckx
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "ledger.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAGIC "doubledecogen ledger 1"
+
+// A ledger is only appended to, one line per finished part, so a crash can
+// only lose the line that was being written.
+
+static int write_options(FILE* file, LedgerOptions* options) {
+  fprintf(file, "%s\n", MAGIC);
+  fprintf(file, "factor %d mod %d split %d lsp %d connectivity %d all %d\n",
+          options->factor, options->mod, options->split_level, options->lsp,
+          options->connectivity, options->all);
+  return fflush(file) || fsync(fileno(file)) || ferror(file) ? -1 : 0;
+}
+
+static int read_options(FILE* file, LedgerOptions* options) {
+  // Return 0 if the ledger was made with the given options.
+
+  char magic[sizeof(MAGIC)];
+  LedgerOptions read;
+
+  return fgets(magic, sizeof(magic), file) && !strcmp(magic, MAGIC) &&
+                 fscanf(file,
+                        " factor %d mod %d split %d lsp %d connectivity %d "
+                        "all %d\n",
+                        &read.factor, &read.mod, &read.split_level, &read.lsp,
+                        &read.connectivity, &read.all) == 6 &&
+                 !memcmp(&read, options, sizeof(read))
+             ? 0
+             : -1;
+}
+
+FILE* open_ledger(const char* filename, LedgerOptions* options) {
+  // Open the ledger for reading its entries and appending new ones. A new
+  // ledger is created with the given options. Return NULL if the ledger can
+  // not be opened, or if it was made with other options.
+
+  FILE* file;
+
+  if (!(file = fopen(filename, "a+")))
+    return NULL;
+  fseek(file, 0, SEEK_END);
+  if ((ftell(file) == 0 && write_options(file, options)) ||
+      fseek(file, 0, SEEK_SET) || read_options(file, options)) {
+    fclose(file);
+    return NULL;
+  }
+
+  return file;
+}
+
+static int read_number(char** p, const char* word, unsigned long long* n) {
+  // Read the word, if given, and the number after it. Return whether both
+  // were found.
+
+  char* end;
+
+  if (word) {
+    while (**p == ' ')
+      (*p)++;
+    if (strncmp(*p, word, strlen(word)))
+      return 0;
+    *p += strlen(word);
+  }
+  *n = strtoull(*p, &end, 10);
+  if (end == *p)
+    return 0;
+  *p = end;
+
+  return 1;
+}
+
+int parse_ledger_entry(const char* line, int factor, LedgerEntry* entry) {
+  // Parse a line of the ledger. Return 0 on success.
+
+  char *p = (char*)line, *end;
+  unsigned long long part;
+  int ok;
+
+  ok = read_number(&p, "part", &part) && part < (1 << 30);
+  if (ok) {
+    entry->part = part;
+    while (*p == ' ')
+      p++;
+    ok = !strncmp(p, "seconds", 7);
+  }
+  if (ok) {
+    entry->seconds = strtod(p + 7, &end);
+    ok = end != p + 7;
+    p = end;
+  }
+  for (int f = 1; ok && f <= factor; f++)
+    ok = read_number(&p, f == 1 ? "count" : NULL, &entry->count[f]);
+  for (int f = 1; ok && f <= factor; f++)
+    ok = read_number(&p, f == 1 ? "precount" : NULL, &entry->precount[f]);
+
+  return ok && (*p == '\n' || *p == '\0') ? 0 : -1;
+}
+
+int read_ledger_entry(FILE* file, int factor, LedgerEntry* entry) {
+  // Read the next entry of the ledger, skipping lines that can not be parsed.
+  // Return 0 on success, and -1 at the end of the ledger. A line that was cut
+  // off by a crash ends the ledger, and is terminated so the next entry
+  // starts on a new line.
+
+  char* line = NULL;
+  size_t capacity = 0;
+  ssize_t length;
+
+  while ((length = getline(&line, &capacity, file)) > 0) {
+    if (line[length - 1] != '\n') {
+      fputc('\n', file);
+      fflush(file);
+      break;
+    }
+    if (!parse_ledger_entry(line, factor, entry)) {
+      free(line);
+      return 0;
+    }
+  }
+
+  free(line);
+  return -1;
+}
+
+void print_ledger_entry(FILE* file, int factor, LedgerEntry* entry) {
+  // Write the entry as a line of the ledger.
+
+  fprintf(file, "part %d seconds %.3f count", entry->part, entry->seconds);
+  for (int f = 1; f <= factor; f++)
+    fprintf(file, " %llu", entry->count[f]);
+  fprintf(file, " precount");
+  for (int f = 1; f <= factor; f++)
+    fprintf(file, " %llu", entry->precount[f]);
+  fprintf(file, "\n");
+}
+
+int write_ledger_entry(FILE* file, int factor, LedgerEntry* entry) {
+  // Append the entry, and make sure it is on disk. Return 0 on success.
+
+  print_ledger_entry(file, factor, entry);
+
+  return fflush(file) || fsync(fileno(file)) || ferror(file) ? -1 : 0;
+}
@@ -0,0 +1,46 @@
+// Copyright (C) 2022 Pieter Goetschalckx
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef LEDGER_H_
+#define LEDGER_H_
+
+#include <stdio.h>
+#include "util.h"
+
+typedef struct {
+  // The options that determine the parts and their counts.
+  int factor;
+  int mod;
+  int split_level;
+  int lsp;
+  int connectivity;
+  int all;
+} LedgerOptions;
+
+typedef struct {
+  // The counts of a finished part, and the time it took to generate it.
+  int part;
+  double seconds;
+  unsigned long long count[MAXFACTOR + 1];
+  unsigned long long precount[MAXFACTOR + 1];
+} LedgerEntry;
+
+FILE* open_ledger(const char* filename, LedgerOptions* options);
+int parse_ledger_entry(const char* line, int factor, LedgerEntry* entry);
+int read_ledger_entry(FILE* file, int factor, LedgerEntry* entry);
+void print_ledger_entry(FILE* file, int factor, LedgerEntry* entry);
+int write_ledger_entry(FILE* file, int factor, LedgerEntry* entry);
+
+#endif
@@ -0,0 +1,150 @@
+// Copyright (C) 2022 Pieter Goetschalckx
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "network.h"
+#include <netdb.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static int is_tcp(const char* address) {
+  return strchr(address, ':') && !strchr(address, '/');
+}
+
+static struct addrinfo* resolve(const char* address, int passive) {
+  // Return the TCP addresses of HOST:PORT, or NULL if it can not be resolved.
+
+  char host[strlen(address) + 1];
+  char* port;
+  struct addrinfo hints, *addresses;
+
+  strcpy(host, address);
+  port = strrchr(host, ':');
+  *port++ = '\0';
+
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = passive ? AI_PASSIVE : 0;
+  if (getaddrinfo(*host ? host : NULL, port, &hints, &addresses))
+    return NULL;
+
+  return addresses;
+}
+
+static int unix_address(struct sockaddr_un* sun, const char* path) {
+  // Return 0 if the path fits in a Unix domain socket address.
+
+  memset(sun, 0, sizeof(*sun));
+  sun->sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(sun->sun_path))
+    return -1;
+  strcpy(sun->sun_path, path);
+
+  return 0;
+}
+
+int listen_socket(const char* address) {
+  // Return a socket that accepts connections on the address, or -1.
+
+  int fd = -1;
+
+  if (is_tcp(address)) {
+    struct addrinfo* addresses = resolve(address, 1);
+    int reuse = 1;
+
+    for (struct addrinfo* a = addresses; a && fd < 0; a = a->ai_next) {
+      if ((fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol)) < 0)
+        continue;
+      // A restarted coordinator can listen on the same port immediately
+      setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+      if (bind(fd, a->ai_addr, a->ai_addrlen) || listen(fd, SOMAXCONN)) {
+        close(fd);
+        fd = -1;
+      }
+    }
+    if (addresses)
+      freeaddrinfo(addresses);
+  } else {
+    struct sockaddr_un sun;
+    struct stat st;
+
+    if (unix_address(&sun, address))
+      return -1;
+    // Remove the socket of a previous coordinator
+    if (!stat(address, &st) && S_ISSOCK(st.st_mode))
+      unlink(address);
+    if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+      return -1;
+    if (bind(fd, (struct sockaddr*)&sun, sizeof(sun)) ||
+        listen(fd, SOMAXCONN)) {
+      close(fd);
+      fd = -1;
+    }
+  }
+
+  return fd;
+}
+
+int accept_socket(int fd) {
+  // Return a new connection to a socket of listen_socket, or -1.
+
+  return accept(fd, NULL, NULL);
+}
+
+int connect_socket(const char* address) {
+  // Return a socket that is connected to the address, or -1.
+
+  int fd = -1;
+
+  if (is_tcp(address)) {
+    struct addrinfo* addresses = resolve(address, 0);
+
+    for (struct addrinfo* a = addresses; a && fd < 0; a = a->ai_next) {
+      if ((fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol)) < 0)
+        continue;
+      if (connect(fd, a->ai_addr, a->ai_addrlen)) {
+        close(fd);
+        fd = -1;
+      }
+    }
+    if (addresses)
+      freeaddrinfo(addresses);
+  } else {
+    struct sockaddr_un sun;
+
+    if (unix_address(&sun, address))
+      return -1;
+    if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+      return -1;
+    if (connect(fd, (struct sockaddr*)&sun, sizeof(sun))) {
+      close(fd);
+      fd = -1;
+    }
+  }
+
+  return fd;
+}
+
+void close_socket(int fd, const char* address) {
+  // Close a socket of listen_socket, and remove its Unix domain socket.
+
+  close(fd);
+  if (!is_tcp(address))
+    unlink(address);
+}
@@ -0,0 +1,27 @@
+// Copyright (C) 2022 Pieter Goetschalckx
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef NETWORK_H_
+#define NETWORK_H_
+
+// An address is HOST:PORT for TCP, where an empty HOST listens on all
+// interfaces, or the path of a Unix domain socket otherwise.
+
+int listen_socket(const char* address);
+int accept_socket(int fd);
+int connect_socket(const char* address);
+void close_socket(int fd, const char* address);
+
+#endif
@@ -15,55 +15,73 @@
 
 #include "planar_code.h"
 
-unsigned char HEADER[15] = ">>planar_code<<";
+void write_planar_header(FILE* file, int wide) {
+  // The 16-bit variant is little-endian, like the code written below.
 
-static Edge* STARTEDGE[MAXORDER];
-int NUMBER[MAXORDER];
+  fputs(wide ? ">>planar_code le<<" : ">>planar_code<<", file);
+}
 
-unsigned char CODE[MAXORDER + MAXSIZE + 1];
+static unsigned char* put(unsigned char* code, int entry, int wide) {
+  // Write an entry of the planar code, as a little-endian 16-bit number in
+  // the 16-bit variant.
 
-void write_planar_header(FILE* file) {
-  fwrite(HEADER, sizeof(unsigned char), 15, file);
+  if (!wide) {
+    *code = entry;
+    return code + 1;
+  }
+  code[0] = entry & 0xff;
+  code[1] = entry >> 8;
+  return code + 2;
 }
 
-void write_planar_code(FILE* file, DoublePreDeco* dpd) {
+int encode_planar_code(Generator* gen, DoublePreDeco* dpd) {
+  // Store the planar code of the double predecoration in gen->planar_code, and
+  // return its length. The vertex v has number gen->number[v] in the code.
+  // Orders above 255 use the 16-bit variant, which starts with a 0 byte.
+
   int i, actual_number = 1, last_number = 2, vertex;
-  Edge *edge, *run;
-  unsigned char* code = CODE;
+  int wide = MAXORDER > 255 && dpd->order > 255;
+  Edge edge, run;
+  Edge* startedge = gen->startedge;
+  int* number = gen->number;
+  unsigned char* code = gen->planar_code;
 
   for (i = 0; i < dpd->order; i++)
-    NUMBER[i] = 0;
+    number[i] = 0;
 
-  *code = dpd->order;
-  code++;
+  if (wide)
+    *code++ = 0;
+  code = put(code, dpd->order, wide);
 
   if (dpd->order < 2) {
-    *code = 0;
-    code++;
-    return;
+    code = put(code, 0, wide);
+    return code - gen->planar_code;
   }
 
-  edge = get_edge(0);
-  NUMBER[edge->start] = 1;
-  NUMBER[edge->end] = 2;
-  STARTEDGE[1] = edge->inverse;
+  edge = get_edge(gen, 0);
+  number[gen->start[edge]] = 1;
+  number[gen->end[edge]] = 2;
+  startedge[1] = inverse(edge);
 
   while (actual_number <= dpd->order) {
-    *code = NUMBER[edge->end];
-    code++;
-    for (run = edge->next; run != edge; run = run->next) {
-      vertex = run->end;
-      if (!NUMBER[vertex]) {
-        STARTEDGE[last_number++] = run->inverse;
-        NUMBER[vertex] = last_number;
+    code = put(code, number[gen->end[edge]], wide);
+    for (run = gen->next[edge]; run != edge; run = gen->next[run]) {
+      vertex = gen->end[run];
+      if (!number[vertex]) {
+        startedge[last_number++] = inverse(run);
+        number[vertex] = last_number;
       }
-      *code = NUMBER[vertex];
-      code++;
+      code = put(code, number[vertex], wide);
     }
-    *code = 0;
-    code++;
-    edge = STARTEDGE[actual_number++];
+    code = put(code, 0, wide);
+    edge = startedge[actual_number++];
   }
 
-  fwrite(CODE, sizeof(unsigned char), dpd->order + dpd->size + 1, file);
+  return code - gen->planar_code;
+}
+
+void write_planar_code(Generator* gen, FILE* file, DoublePreDeco* dpd) {
+  int length = encode_planar_code(gen, dpd);
+
+  fwrite(gen->planar_code, sizeof(unsigned char), length, file);
 }
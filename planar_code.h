@@ -19,7 +19,8 @@
 #include <stdio.h>
 #include "util.h"
 
-void write_planar_header(FILE*);
-void write_planar_code(FILE*, DoublePreDeco*);
+void write_planar_header(FILE*, int);
+int encode_planar_code(Generator*, DoublePreDeco*);
+void write_planar_code(Generator*, FILE*, DoublePreDeco*);
 
 #endif
@@ -0,0 +1,91 @@
+// Copyright (C) 2022 Pieter Goetschalckx
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include "stats.h"
+#include <stdio.h>
+
+static const char* REJECT_NAMES[NB_REJECTS] = {
+    "n2", "n1", "ext", "list", "prefix", "code", "prune",
+};
+
+void add_stats(Stats* total, Stats* stats, int nb_orders) {
+  for (int order = 0; order < nb_orders; order++) {
+    Stats* t = &total[order];
+    Stats* s = &stats[order];
+
+    t->nodes += s->nodes;
+    t->leaves += s->leaves;
+    for (int ext = 1; ext <= 4; ext++) {
+      t->attempts[ext] += s->attempts[ext];
+      t->successes[ext] += s->successes[ext];
+    }
+    t->canon_calls += s->canon_calls;
+    t->compare_code_calls += s->compare_code_calls;
+    for (int cause = 0; cause < NB_REJECTS; cause++)
+      t->rejects[cause] += s->rejects[cause];
+    for (int sym = 1; sym <= STATS_MAX_SYM; sym++)
+      t->nb_sym[sym] += s->nb_sym[sym];
+    t->seconds += s->seconds;
+  }
+}
+
+static void write_order(FILE* file, int order, Stats* s) {
+  const char* separator = "";
+
+  fprintf(file, "    {\"order\": %d, \"nodes\": %llu, \"leaves\": %llu, ",
+          order, s->nodes, s->leaves);
+  fprintf(file, "\"seconds\": %.6f,\n", s->seconds);
+  fprintf(file, "     \"extensions\": {");
+  for (int ext = 1; ext <= 4; ext++)
+    fprintf(file, "%s\"%d\": {\"attempts\": %llu, \"successes\": %llu}",
+            ext > 1 ? ", " : "", ext, s->attempts[ext], s->successes[ext]);
+  fprintf(file, "},\n");
+  fprintf(file, "     \"canon\": %llu, \"compare_code\": %llu,\n",
+          s->canon_calls, s->compare_code_calls);
+  fprintf(file, "     \"rejects\": {");
+  for (int cause = 0; cause < NB_REJECTS; cause++)
+    fprintf(file, "%s\"%s\": %llu", cause ? ", " : "", REJECT_NAMES[cause],
+            s->rejects[cause]);
+  fprintf(file, "},\n");
+  fprintf(file, "     \"nb_sym\": {");
+  for (int sym = 1; sym <= STATS_MAX_SYM; sym++) {
+    if (!s->nb_sym[sym])
+      continue;
+    fprintf(file, "%s\"%d%s\": %llu", separator, sym,
+            sym == STATS_MAX_SYM ? "+" : "", s->nb_sym[sym]);
+    separator = ", ";
+  }
+  fprintf(file, "}}");
+}
+
+int write_stats(const char* filename, int factor, Stats* stats) {
+  // Write the counters of the orders up to the leaves of the factor as JSON.
+  // Return 0 on success.
+
+  int max_order = (factor + 1) / 2 + 2;
+  FILE* file;
+
+  if (!(file = fopen(filename, "w")))
+    return -1;
+
+  fprintf(file, "{\n  \"factor\": %d,\n  \"orders\": [\n", factor);
+  for (int order = 3; order <= max_order; order++) {
+    write_order(file, order, &stats[order]);
+    fprintf(file, order < max_order ? ",\n" : "\n");
+  }
+  fprintf(file, "  ]\n}\n");
+
+  return fclose(file) ? -1 : 0;
+}
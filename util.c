@@ -14,124 +14,218 @@
 // along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "util.h"
+#include <stdlib.h>
 #include <string.h>
 
-static Edge EDGES[MAXSIZE];
-static Edge* FIRSTEDGE[MAXORDER];
-static int DEG[MAXORDER];
+Generator* create_generator() {
+  Generator* gen = calloc(1, sizeof(Generator));
+  pthread_mutex_init(&gen->lock, NULL);
+  return gen;
+}
+
+void free_generator(Generator* gen) {
+  pthread_mutex_destroy(&gen->lock);
+  free(gen);
+}
+
+void copy_predeco(DoublePreDeco* copy, DoublePreDeco* dpd) {
+  *copy = *dpd;
+}
 
-int create_vertex(DoublePreDeco* dpd) {
-  DEG[dpd->order] = 0;
+int create_vertex(Generator* gen, DoublePreDeco* dpd) {
+  gen->deg[dpd->order] = 0;
   return dpd->order++;
 }
 
-void _increase_deg(DoublePreDeco* dpd, int vertex) {
-  int i;
-  switch (DEG[vertex]) {
+static void _increase_deg(Generator* gen, DoublePreDeco* dpd, int vertex) {
+  switch (gen->deg[vertex]) {
     case 0:
-      dpd->deg1[dpd->n1++] = vertex;
+      add_vertex(&dpd->deg1, vertex);
+      dpd->n1++;
       break;
     case 1:
-      for (i = 0; dpd->deg1[i] != vertex; i++)
-        ;
-      dpd->deg1[i] = dpd->deg1[--(dpd->n1)];
-      dpd->deg2[dpd->n2++] = vertex;
+      remove_vertex(&dpd->deg1, vertex);
+      dpd->n1--;
+      add_vertex(&dpd->deg2, vertex);
+      dpd->n2++;
       break;
     case 2:
-      for (i = 0; dpd->deg2[i] != vertex; i++)
-        ;
-      dpd->deg2[i] = dpd->deg2[--(dpd->n2)];
+      remove_vertex(&dpd->deg2, vertex);
+      dpd->n2--;
+      add_vertex(&dpd->deg3, vertex);
+      break;
+    case 3:
+      remove_vertex(&dpd->deg3, vertex);
       break;
   }
-  DEG[vertex] += 1;
+  gen->deg[vertex] += 1;
 }
 
-void _decrease_deg(DoublePreDeco* dpd, int vertex) {
-  int i;
-  switch (DEG[vertex]) {
+static void _decrease_deg(Generator* gen, DoublePreDeco* dpd, int vertex) {
+  switch (gen->deg[vertex]) {
     case 1:
-      for (i = 0; dpd->deg1[i] != vertex; i++)
-        ;
-      dpd->deg1[i] = dpd->deg1[--(dpd->n1)];
+      remove_vertex(&dpd->deg1, vertex);
+      dpd->n1--;
       break;
     case 2:
-      for (i = 0; dpd->deg2[i] != vertex; i++)
-        ;
-      dpd->deg2[i] = dpd->deg2[--(dpd->n2)];
-      dpd->deg1[dpd->n1++] = vertex;
+      remove_vertex(&dpd->deg2, vertex);
+      dpd->n2--;
+      add_vertex(&dpd->deg1, vertex);
+      dpd->n1++;
       break;
     case 3:
-      dpd->deg2[dpd->n2++] = vertex;
+      remove_vertex(&dpd->deg3, vertex);
+      add_vertex(&dpd->deg2, vertex);
+      dpd->n2++;
+      break;
+    case 4:
+      add_vertex(&dpd->deg3, vertex);
       break;
   }
-  DEG[vertex] -= 1;
+  gen->deg[vertex] -= 1;
 }
 
-Edge* create_edge(DoublePreDeco* dpd, int start, int end) {
+Edge create_edge(Generator* gen, DoublePreDeco* dpd, int start, int end) {
   int i;
 
-  Edge* edge = &EDGES[dpd->size++];
-  Edge* inverse = &EDGES[dpd->size++];
-  edge->inverse = inverse;
-  inverse->inverse = edge;
-  edge->start = inverse->end = start;
-  edge->end = inverse->start = end;
-  _increase_deg(dpd, start);
-  _increase_deg(dpd, end);
-  FIRSTEDGE[start] = edge;
-  FIRSTEDGE[end] = inverse;
+  Edge edge = dpd->size++;
+  Edge back = dpd->size++;
+  gen->start[edge] = gen->end[back] = start;
+  gen->end[edge] = gen->start[back] = end;
+  _increase_deg(gen, dpd, start);
+  _increase_deg(gen, dpd, end);
+  gen->firstedge[start] = edge;
+  gen->firstedge[end] = back;
   return edge;
 }
 
-void set_next(Edge* edge, Edge* next) {
-  edge->next = next;
-  next->prev = edge;
+Edge inverse(Edge edge) {
+  return edge ^ 1;
 }
 
-void detach(DoublePreDeco* dpd, Edge* edge) {
-  set_next(edge->prev, edge->next);
-  if (FIRSTEDGE[edge->start] == edge) {
-    FIRSTEDGE[edge->start] = edge->prev;
-  }
-  _decrease_deg(dpd, edge->start);
+void set_next(Generator* gen, Edge edge, Edge next) {
+  gen->next[edge] = next;
+  gen->prev[next] = edge;
 }
 
-void attach(DoublePreDeco* dpd, Edge* prev, Edge* edge) {
-  edge->start = edge->inverse->end = prev->start;
-  _increase_deg(dpd, prev->start);
-  set_next(edge, prev->next);
-  set_next(prev, edge);
+void detach(Generator* gen, DoublePreDeco* dpd, Edge edge) {
+  set_next(gen, gen->prev[edge], gen->next[edge]);
+  if (gen->firstedge[gen->start[edge]] == edge) {
+    gen->firstedge[gen->start[edge]] = gen->prev[edge];
+  }
+  _decrease_deg(gen, dpd, gen->start[edge]);
 }
 
-void remove_extension(DoublePreDeco* dpd) {
-  int i, vertex = --(dpd->order);
+void attach(Generator* gen, DoublePreDeco* dpd, Edge prev, Edge edge) {
+  gen->start[edge] = gen->end[inverse(edge)] = gen->start[prev];
+  _increase_deg(gen, dpd, gen->start[prev]);
+  set_next(gen, edge, gen->next[prev]);
+  set_next(gen, prev, edge);
+}
 
-  for (int i = 0; i < 4; i++) {
-    Edge* edge = &EDGES[--(dpd->size)];
-    if (edge->start != vertex)
-      detach(dpd, edge);
+void remove_extension(Generator* gen, DoublePreDeco* dpd) {
+  // Remove the last vertex and its edges from the embedding. Only the
+  // embedding and the degrees are restored. dpd is left as it is, since the
+  // search keeps a copy of the double predecoration before the extension.
+
+  int vertex = dpd->order - 1;
+
+  for (int i = 1; i <= 4; i++) {
+    Edge edge = dpd->size - i;
+    int start = gen->start[edge];
+    if (start != vertex) {
+      set_next(gen, gen->prev[edge], gen->next[edge]);
+      if (gen->firstedge[start] == edge)
+        gen->firstedge[start] = gen->prev[edge];
+      gen->deg[start]--;
+    }
   }
+}
 
-  switch (DEG[vertex]) {
-    case 1:
-      for (i = 0; dpd->deg1[i] != vertex; i++)
-        ;
-      dpd->deg1[i] = dpd->deg1[--(dpd->n1)];
-      break;
-    case 2:
-      for (i = 0; dpd->deg2[i] != vertex; i++)
-        ;
-      dpd->deg2[i] = dpd->deg2[--(dpd->n2)];
-      break;
-  }
+void restore_edge(Generator* gen, Edge prev, Edge edge) {
+  // Attach the edge after prev, like attach, but for a reduction: only the
+  // embedding and the degree are restored.
+
+  gen->start[edge] = gen->end[inverse(edge)] = gen->start[prev];
+  gen->deg[gen->start[prev]]++;
+  set_next(gen, edge, gen->next[prev]);
+  set_next(gen, prev, edge);
+}
+
+#if MAXORDER <= 64
+
+void clear_vertices(VertexSet* set) {
+  *set = 0;
+}
+
+void add_vertex(VertexSet* set, int vertex) {
+  *set |= 1ULL << vertex;
+}
+
+void remove_vertex(VertexSet* set, int vertex) {
+  *set &= ~(1ULL << vertex);
+}
+
+int has_vertex(VertexSet* set, int vertex) {
+  return *set >> vertex & 1;
 }
 
-Edge* get_edge(int vertex) {
-  return FIRSTEDGE[vertex];
+int pop_vertex(VertexSet* set) {
+  // Remove the first vertex from the set and return it, or return -1 if the
+  // set is empty.
+
+  if (!*set)
+    return -1;
+  int vertex = __builtin_ctzll(*set);
+  *set &= *set - 1;
+  return vertex;
 }
 
-int degree(int vertex) {
-  return DEG[vertex];
+#else
+
+void clear_vertices(VertexSet* set) {
+  memset(set, 0, sizeof(VertexSet));
+}
+
+void add_vertex(VertexSet* set, int vertex) {
+  set->words[vertex / 64] |= 1ULL << vertex % 64;
+}
+
+void remove_vertex(VertexSet* set, int vertex) {
+  set->words[vertex / 64] &= ~(1ULL << vertex % 64);
+}
+
+int has_vertex(VertexSet* set, int vertex) {
+  return set->words[vertex / 64] >> vertex % 64 & 1;
+}
+
+int pop_vertex(VertexSet* set) {
+  for (int i = 0; i < (MAXORDER + 63) / 64; i++)
+    if (set->words[i]) {
+      int vertex = 64 * i + __builtin_ctzll(set->words[i]);
+      set->words[i] &= set->words[i] - 1;
+      return vertex;
+    }
+  return -1;
+}
+
+#endif
+
+VertexSet without_vertex(VertexSet set, int vertex) {
+  remove_vertex(&set, vertex);
+  return set;
+}
+
+int first_vertex(VertexSet set) {
+  return pop_vertex(&set);
+}
+
+Edge get_edge(Generator* gen, int vertex) {
+  return gen->firstedge[vertex];
+}
+
+int degree(Generator* gen, int vertex) {
+  return gen->deg[vertex];
 }
 
 void reset_vertex_marks(VertexMarks* marks, int range) {
@@ -169,34 +263,30 @@ void reset_edge_marks(EdgeMarks* marks, int range) {
 #endif
 }
 
-void mark_edge(EdgeMarks* marks, Edge* edge, int mark) {
+void mark_edge(EdgeMarks* marks, Edge edge, int mark) {
   assert(mark <= marks->range);
-  marks->marks[edge - EDGES] = marks->unmarked + mark;
+  marks->marks[edge] = marks->unmarked + mark;
 }
 
-int edge_mark(EdgeMarks* marks, Edge* edge) {
-  return marks->marks[edge - EDGES] > marks->unmarked &&
-         marks->marks[edge - EDGES];
+int edge_mark(EdgeMarks* marks, Edge edge) {
+  return marks->marks[edge] > marks->unmarked &&
+         marks->marks[edge];
 }
 
-static unsigned long long PRECOUNT = 0;
-
-void precount(int n) {
-  PRECOUNT += n;
+void precount(Generator* gen, int n) {
+  gen->precount[gen->factor] += n;
 }
 
-unsigned long long get_precount() {
-  return PRECOUNT;
+unsigned long long get_precount(Generator* gen, int factor) {
+  return gen->precount[factor];
 }
 
-static unsigned long long COUNT = 0;
-
-void count(int n) {
-  COUNT += n;
+void count(Generator* gen, int n) {
+  gen->count[gen->factor] += n;
 }
 
-unsigned long long get_count() {
-  return COUNT;
+unsigned long long get_count(Generator* gen, int factor) {
+  return gen->count[factor];
 }
 
 static int FILTER_LSP = 0;
@@ -209,75 +299,93 @@ int get_filter_lsp() {
   return FILTER_LSP;
 }
 
+static int CONNECTIVITY = 3;
+
+void set_connectivity(int value) {
+  CONNECTIVITY = value;
+}
+
+int get_connectivity() {
+  return CONNECTIVITY;
+}
+
+int low_degree(Generator* gen, int vertex) {
+  // Vertices with a degree lower than the connectivity have to be a corner
+  // of the decoration.
+
+  return gen->deg[vertex] < CONNECTIVITY;
+}
+
+int nb_low_degree(DoublePreDeco* dpd) {
+  return (CONNECTIVITY > 1 ? dpd->n1 : 0) + (CONNECTIVITY > 2 ? dpd->n2 : 0);
+}
+
 #ifdef DEBUG
 
 #include <stdio.h>
 
-static EdgeMarks _CHECKMARKS;
-static EdgeMarks* CHECKMARKS = &_CHECKMARKS;
-
-void check(DoublePreDeco* dpd) {
+void check(Generator* gen, DoublePreDeco* dpd) {
   int i, vertex;
-  Edge *edge, *temp;
+  Edge edge, temp;
   int size = 0, n1 = 0, n2 = 0;
 
   assert(dpd->order <= MAXORDER);
   assert(dpd->size <= MAXSIZE);
 
   for (vertex = 0; vertex < dpd->order; vertex++) {
-    size += degree(vertex);
-    if (degree(vertex) == 1)
+    size += degree(gen, vertex);
+    if (degree(gen, vertex) == 1)
       n1++;
-    else if (degree(vertex) == 2)
+    else if (degree(gen, vertex) == 2)
       n2++;
 
-    for (edge = get_edge(vertex), i = 0; i < degree(vertex);
-         edge = edge->next, i++) {
-      assert(edge->start == vertex);
-      assert(edge->end != vertex);
-      assert(edge->end >= 0);
-      assert(edge->end < dpd->order);
-      assert(edge->prev->next == edge);
+    for (edge = get_edge(gen, vertex), i = 0; i < degree(gen, vertex);
+         edge = gen->next[edge], i++) {
+      assert(gen->start[edge] == vertex);
+      assert(gen->end[edge] != vertex);
+      assert(gen->end[edge] >= 0);
+      assert(gen->end[edge] < dpd->order);
+      assert(gen->next[gen->prev[edge]] == edge);
     }
-    assert(edge == get_edge(vertex));
+    assert(edge == get_edge(gen, vertex));
   }
   assert(dpd->size == size);
   assert(dpd->n1 == n1);
   assert(dpd->n2 == n2);
 
-  for (i = 0; i < dpd->n1; i++) {
-    assert(degree(dpd->deg1[i]) == 1);
-  }
-  for (i = 0; i < dpd->n2; i++) {
-    assert(degree(dpd->deg2[i]) == 2);
+  for (vertex = 0; vertex < MAXORDER; vertex++) {
+    int d = vertex < dpd->order ? degree(gen, vertex) : 0;
+    assert(has_vertex(&dpd->deg1, vertex) == (d == 1));
+    assert(has_vertex(&dpd->deg2, vertex) == (d == 2));
+    assert(has_vertex(&dpd->deg3, vertex) == (d == 3));
   }
 
-  reset_edge_marks(CHECKMARKS, 1);
-  for (edge = EDGES; edge < EDGES + dpd->size; edge++) {
-    if (!edge_mark(CHECKMARKS, edge)) {
-      for (temp = edge, i = 0; i < 4; temp = temp->inverse->prev, i++) {
-        assert(!edge_mark(CHECKMARKS, temp));
-        mark_edge(CHECKMARKS, temp, 1);
+  reset_edge_marks(&gen->checkmarks, 1);
+  for (edge = 0; edge < dpd->size; edge++) {
+    if (!edge_mark(&gen->checkmarks, edge)) {
+      for (temp = edge, i = 0; i < 4; temp = gen->prev[inverse(temp)], i++) {
+        assert(!edge_mark(&gen->checkmarks, temp));
+        mark_edge(&gen->checkmarks, temp, 1);
       }
       assert(temp == edge);
     }
   }
 }
 
-void print(DoublePreDeco* dpd) {
+void print(Generator* gen, DoublePreDeco* dpd) {
   int i, vertex;
-  Edge* edge;
+  Edge edge;
 
   printf("order: %d, size: %d, n1: %d, n2: %d\n", dpd->order, dpd->size,
          dpd->n1, dpd->n2);
 
   for (vertex = 0; vertex < dpd->order; vertex++) {
     printf("\n");
-    edge = get_edge(vertex);
+    edge = get_edge(gen, vertex);
     do {
-      printf("%d -> %d\n", edge->start, edge->end);
-      edge = edge->next;
-    } while (edge != get_edge(vertex));
+      printf("%d -> %d\n", gen->start[edge], gen->end[edge]);
+      edge = gen->next[edge];
+    } while (edge != get_edge(gen, vertex));
   }
 }
 
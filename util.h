@@ -16,40 +16,84 @@
 #ifndef UTIL_H_
 #define UTIL_H_
 
+#include <pthread.h>
+#include <stdio.h>
+
+// The limits can be raised at compile time, e.g. make MAXFACTOR=1000. The
+// default keeps edges and vertices in bytes and vertex sets in one word.
+#ifndef MAXFACTOR
 #define MAXFACTOR 100
-#define MAXORDER 52  // (MAXFACTOR + 1) / 2 + 2
-#define MAXSIZE 202  // 2 * (MAXFACTOR + 1)
+#endif
+#define MAXORDER ((MAXFACTOR + 1) / 2 + 2)
+#define MAXSIZE (2 * (MAXFACTOR + 1))
+#define MAXDEGREE (MAXSIZE / 2)
 
-typedef struct _Edge {
-  int start;
-  int end;
+#if MAXSIZE > 65536
+#error "MAXFACTOR is too large for 16-bit edges"
+#endif
 
-  struct _Edge* prev;
-  struct _Edge* next;
-  struct _Edge* inverse;
-} Edge;
+// Codes are offset by CODE_ZERO, so that their entries are positive and are
+// ordered like -MAXDEGREE, ..., 0, 1.
+#define CODE_ZERO (MAXDEGREE + 1)
+
+// Larger than most decocode records. A longer record grows the buffer.
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+
+// An edge is an index in the embedding arrays of the generator. The edges 2i
+// and 2i + 1 are each other's inverse. Vertices are stored in the same type,
+// so union-find forests of edges and vertices are interchangeable.
+#if MAXSIZE < 256
+#define MAXGENERATORS 8  // log2(MAXSIZE)
+typedef unsigned char Edge;
+typedef unsigned char Vertex;
+typedef unsigned char CodeEntry;
+#else
+#define MAXGENERATORS 16
+typedef unsigned short Edge;
+typedef unsigned short Vertex;
+typedef unsigned short CodeEntry;
+#endif
+
+// A set of vertices as a bitmask.
+#if MAXORDER <= 64
+typedef unsigned long long VertexSet;
+#else
+typedef struct {
+  unsigned long long words[(MAXORDER + 63) / 64];
+} VertexSet;
+#endif
 
 typedef struct {
   int order;
   int size;
 
+  // The vertices of degree 1, 2 and 3, and the number of them for the
+  // degrees that bound the low degree vertices.
   int n1;
-  int deg1[5];
+  VertexSet deg1;
   int n2;
-  int deg2[5];
+  VertexSet deg2;
+  VertexSet deg3;
 } DoublePreDeco;
 
-int create_vertex(DoublePreDeco*);
-Edge* create_edge(DoublePreDeco*, int, int);
+typedef struct {
+  // A node on the path of the depth-first search, together with the child
+  // that is being explored.
 
-void set_next(Edge*, Edge*);
-void detach(DoublePreDeco*, Edge*);
-void attach(DoublePreDeco*, Edge*, Edge*);
+  DoublePreDeco dpd;
+  int nb_edge_orbits;
 
-void remove_extension(DoublePreDeco*);
+  // Extension type ext at canonical edge i is the child with index
+  // (ext - 1) * nb_edge_orbits + i. The children with index at least end are
+  // left to other threads.
+  int child;
+  int end;
 
-Edge* get_edge(int);
-int degree(int);
+  // The extension that was applied for the current child, to be reduced when
+  // the search returns to this node.
+  int ext;
+  Edge edge;
+} Frame;
 
 typedef struct {
   unsigned int unmarked;
@@ -57,39 +101,180 @@ typedef struct {
   unsigned int marks[MAXORDER];
 } VertexMarks;
 
-void reset_vertex_marks(VertexMarks*, int);
-void mark_vertex(VertexMarks*, int, int);
-int vertex_mark(VertexMarks*, int);
-
 typedef struct {
   unsigned int unmarked;
   unsigned int range;
   unsigned int marks[MAXSIZE];
 } EdgeMarks;
 
+typedef struct {
+  // The output of one generator to one file. Only complete records are
+  // flushed, so the records of different threads do not interleave.
+
+  FILE* file;
+  size_t length;
+  size_t record;  // The start of the record that is being written
+  size_t capacity;
+  unsigned char* data;
+} OutputBuffer;
+
+// The causes for which canon rejects a node, and prune before canon.
+enum { REJECT_N2, REJECT_N1, REJECT_EXT, REJECT_LIST, REJECT_PREFIX,
+       REJECT_CODE, REJECT_PRUNE, NB_REJECTS };
+
+// Automorphism group sizes from STATS_MAX_SYM on share a bucket.
+#define STATS_MAX_SYM 64
+
+typedef struct {
+  // Counters of the nodes of one order, for --stats. Extensions are counted
+  // at the order of the node that they construct.
+
+  unsigned long long nodes;
+  unsigned long long leaves;
+  unsigned long long attempts[5];
+  unsigned long long successes[5];
+  unsigned long long canon_calls;
+  unsigned long long compare_code_calls;
+  unsigned long long rejects[NB_REJECTS];
+  unsigned long long nb_sym[STATS_MAX_SYM + 1];
+  double seconds;
+} Stats;
+
+typedef struct {
+  // All mutable state of one generator. Independent generators can run
+  // concurrently in different threads.
+
+  /* Embedding */
+  // Indexed by edge, so that the embedding fits in a few cache lines.
+  Vertex start[MAXSIZE];
+  Vertex end[MAXSIZE];
+  Edge prev[MAXSIZE];
+  Edge next[MAXSIZE];
+  Edge firstedge[MAXORDER];
+  int deg[MAXORDER];
+
+  /* Canonical form and symmetry */
+  Edge startedge[MAXORDER];
+  Edge startedge2[MAXORDER];
+  CodeEntry code[MAXSIZE];
+  Edge edgeorder[MAXSIZE];
+  Edge edgelist[MAXSIZE];
+  // The number of automorphisms, and a generating set of them as edge
+  // permutations. The group acts freely on the edges, so it has at most
+  // MAXSIZE elements and a chain of at most MAXGENERATORS subgroups.
+  int nb_sym;
+  int nb_generators;
+  Edge generators[MAXGENERATORS][MAXSIZE];
+  // Union-find forests of the orbits, and a rotation around a fixed vertex
+  Edge edge_orbits[MAXSIZE];
+  Vertex vertex_orbits[MAXORDER];
+  Vertex rotation[MAXORDER];
+  // The fixpoints of each orientation-reversing automorphism
+  Edge reflection_edge;
+  int nb_reflections;
+  VertexSet reflections[MAXSIZE];
+  int image[MAXORDER];
+  VertexMarks vertexmarks;
+  VertexMarks vertexmarks2;
+  EdgeMarks edgemarks;
+
+  /* Construction */
+  Edge canonical_edges[MAXORDER][MAXSIZE];
+  int canonical_vertices[MAXORDER];
+  int canonical_vertices_fixed[MAXORDER];
+  unsigned long long nb_split_nodes;
+
+  /* Traversal */
+  int thread;
+  int base;
+  int root;
+  int depth;
+  Frame frames[MAXORDER];
+  pthread_mutex_t lock;
+
+  /* Output */
+  int number[MAXORDER];
+  // Orders above 255 use the 16-bit variant, which starts with a 0 byte.
+  unsigned char planar_code[2 * (MAXORDER + MAXSIZE + 1) + 1];
+  int planar_code_length;
+  // The decocode buffer of each factor, and the buffer of the factor that is
+  // being completed. The planar code is written before its first decoration.
+  OutputBuffer* buffers[MAXFACTOR + 1];
+  OutputBuffer* buffer;
+  int pending;
+
+  /* Counters */
+  // The counters of each factor. The completion counts for the given factor.
+  int factor;
+  unsigned long long precount[MAXFACTOR + 1];
+  unsigned long long count[MAXFACTOR + 1];
+  // The counters of each order with --stats, or NULL
+  Stats* stats;
+
+#ifdef DEBUG
+  EdgeMarks checkmarks;
+#endif
+} Generator;
+
+Generator* create_generator();
+void free_generator(Generator*);
+
+void copy_predeco(DoublePreDeco*, DoublePreDeco*);
+
+int create_vertex(Generator*, DoublePreDeco*);
+Edge create_edge(Generator*, DoublePreDeco*, int, int);
+
+Edge inverse(Edge);
+void set_next(Generator*, Edge, Edge);
+void detach(Generator*, DoublePreDeco*, Edge);
+void attach(Generator*, DoublePreDeco*, Edge, Edge);
+
+void remove_extension(Generator*, DoublePreDeco*);
+void restore_edge(Generator*, Edge, Edge);
+
+void clear_vertices(VertexSet*);
+void add_vertex(VertexSet*, int);
+void remove_vertex(VertexSet*, int);
+int has_vertex(VertexSet*, int);
+VertexSet without_vertex(VertexSet, int);
+int first_vertex(VertexSet);
+int pop_vertex(VertexSet*);
+
+Edge get_edge(Generator*, int);
+int degree(Generator*, int);
+
+void reset_vertex_marks(VertexMarks*, int);
+void mark_vertex(VertexMarks*, int, int);
+int vertex_mark(VertexMarks*, int);
+
 void reset_edge_marks(EdgeMarks*, int);
-void mark_edge(EdgeMarks*, Edge*, int);
-int edge_mark(EdgeMarks*, Edge*);
+void mark_edge(EdgeMarks*, Edge, int);
+int edge_mark(EdgeMarks*, Edge);
 
-void precount(int);
-unsigned long long get_precount();
+void precount(Generator*, int);
+unsigned long long get_precount(Generator*, int);
 
-void count(int);
-unsigned long long get_count();
+void count(Generator*, int);
+unsigned long long get_count(Generator*, int);
 
 void filter_lsp(int);
 int get_filter_lsp();
 
+void set_connectivity(int);
+int get_connectivity();
+int low_degree(Generator*, int);
+int nb_low_degree(DoublePreDeco*);
+
 #ifdef DEBUG
 
-void check(DoublePreDeco* dpd);
-void print(DoublePreDeco* dpd);
-#define CHECK(dpd) check(dpd)
+void check(Generator* gen, DoublePreDeco* dpd);
+void print(Generator* gen, DoublePreDeco* dpd);
+#define CHECK(gen, dpd) check(gen, dpd)
 
 #else
 
 #define NDEBUG
-#define CHECK(dpd)
+#define CHECK(gen, dpd)
 
 #endif
 